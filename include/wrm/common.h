@@ -72,8 +72,9 @@ typedef unsigned long ulong;
 typedef struct wrm_Ref wrm_Ref;
 
 struct wrm_Ref {
-    u32 src;
-    u32 idx;
+    u32 src; // id of the structure holding the object
+    u32 idx; // slot of the object in its source
+    u32 gen; // generation of the slot when the reference was made
 };
 
 /* --- TYPE MACROS --------------------------------------------------------- */
@@ -31,6 +31,7 @@ REQUIREMENTS:
 
 #include "wrm/common.h"
 #include "wrm/linmath.h"
+#include "wrm/memory.h"
 #include "SDL2/SDL.h"
 
 /* --- Type Declarations --------------------------------------------------- */
@@ -147,8 +148,6 @@ extern const u32 WRM_MESH_FAN;
 extern const u32 WRM_DEFAULT_WINDOW_WIDTH;
 extern const u32 WRM_DEFAULT_WINDOW_HEIGHT;
 
-#define WRM_MODEL_CHILD_LIMIT 4
-
 // bit masks for colors 
 
 #define WRM_RGBA32_R_BITS 0xff000000u
@@ -176,10 +175,12 @@ extern const u32 WRM_DEFAULT_WINDOW_HEIGHT;
 /* 
 Initialize the renderer - opens a window with a GL context, 
 sets up default shaders 
+All renderer memory comes from `allocator`, or the C heap if it is NULL
 */
 bool wrm_gfx_init(
     const wrm_gfx_Settings *settings, 
-    const wrm_gfx_Window_Info *winargs
+    const wrm_gfx_Window_Info *winargs,
+    const wrm_Allocator *allocator
 );
 /* Shut down the renderer and clean up resources */
 void wrm_gfx_quit(void);
@@ -149,8 +149,8 @@ Function declarations
 
 // module
 
-/* Initialize the gui system */
-bool wrm_gui_init(const char *shader_dir);
+/* Initialize the gui system; all gui memory comes from `allocator`, or the C heap if it is NULL */
+bool wrm_gui_init(const char *shader_dir, const wrm_Allocator *allocator);
 /* Update gui state based on user input */
 void wrm_gui_update(void);
 /* draw the most recently updated gui */
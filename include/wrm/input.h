@@ -25,6 +25,7 @@ REQUIREMENTS:
 */
 
 #include "wrm/common.h"
+#include "wrm/memory.h"
 #include "SDL2/SDL.h"
 
 
@@ -75,8 +76,8 @@ extern bool wrm_input_should_quit;
 Module functions
 */
 
-/* Initialize reading user input */
-bool wrm_input_init(wrm_Settings *s, SDL_Window *w);
+/* Initialize reading user input; input memory comes from `allocator`, or the C heap if it is NULL */
+bool wrm_input_init(wrm_Settings *s, SDL_Window *w, const wrm_Allocator *allocator);
 
 void wrm_input_update(void);
 
@@ -3,179 +3,984 @@
 /* --- HEADER DESCRIPTION -----------------------------------------------------
 File memory.h
 
-Created  Nov 14, 2025 
+Created  Nov 14, 2025
 by William R Mungas (wrm)
 
 (Last modified Nov 14, 2025)
 
 DESCRIPTION:
-Basic memory management schemes for applications. Each type of allocator takes 
-an initial block of memory; the user decides whether this should be allowed to 
+Basic memory management schemes for applications. Each type of allocator takes
+an initial block of memory; the user decides whether this should be allowed to
 grow or not.
 
 PROVIDES:
+- allocator interface: every container gets, resizes and releases its memory
+    through a `wrm_Allocator`, so the application decides where memory comes
+    from; NULL means the C heap
+- tracking allocator: forwards to another allocator and counts calls, bytes in
+    use and peak bytes
+- slab allocator: an allocator for small objects of varying size, with one
+    free list per power-of-two size class and 64 KiB page-backed slabs
 - pool type: a collection of objects of a known size, to be randomly accessed,
-    modified, or removed
-- stack type: a list of elements of known size with stack behavior, growing 
+    modified, or removed; freed slots are kept on a free list so that getting
+    and freeing a slot are both O(1)
+- generational references (wrm_Ref) into pools: a reference made before its
+    slot was freed and reused no longer resolves
+- bit vector helpers; pools track slot occupancy in 64-bit words and can be
+    iterated with `wrm_Pool_FOR_EACH`, which skips empty words entirely
+- dense pools: a pool whose items are kept packed at the front of `data`
+    (a sparse set), so live items can be walked linearly; slot indices stay
+    stable through an indirection table
+- virtual pools and stacks: reserve address space for a maximum capacity up
+    front and commit pages as they grow, so growing never copies and element
+    addresses stay the same for the container's lifetime
+- pool compaction: moves live items to the lowest slots and rewrites the
+    registered index fields (and trees) that point into the pool
+- memory statistics: pools and stacks count their high-water mark, resizes
+    and the bytes carried over by them; a registry of named containers can
+    dump everything as a table or JSON and report leaks at shutdown
+- snapshots: copies of the full state of a pool, stack or flattened tree that
+    can be restored in a few memcpy()s; pools can track which elements were
+    written since a snapshot and restore only those
+- structure-of-arrays pools: a pool whose items are split into several
+    parallel field arrays behind one slot index, so hot fields can be walked
+    without pulling cold ones through the cache
+- concurrent pool: a fixed-capacity pool whose slots can be taken and freed
+    from any thread without locks, handing out generational references
+- ring type: a lock-free queue of elements between threads, with single- and
+    multi-producer variants, batch push/pop and in-place reserve/commit
+- stack type: a list of elements of known size with stack behavior, growing
     until a rollback
-- aligned_stack:
+- arena type: a byte-granular linear allocator with aligned pushes and
+    save/restore markers, backed by virtual memory so it never moves; usable
+    as a `wrm_Allocator` for containers whose memory lives until a rollback
+- frame arena: a pair of arenas that swap every frame, for transient per-frame
+    data that must stay valid until the end of the following frame
+- tree type: parent/child associations between elements of a pool, linked
+    intrusively through each element's node so fan-out is unbounded
+- tree iteration: pre- and post-order iterators and a visitor that can prune
+    subtrees, keeping their path in an arena instead of recursing
+- map type: an open-addressing hash map from keys to values of known sizes,
+    probing a group of 16 control bytes at a time (with SSE2 where available)
+- key sorting: a stable LSD radix sort of 64-bit key/index pairs, so large
+    records can be ordered without moving them or calling a comparison function
+- flattened trees: a tree that also keeps its nodes in pre-order in
+    contiguous arrays with parent positions and subtree sizes, rebuilt lazily
+    after the topology changes, so a hierarchy can be walked with a forward loop
 
 REQUIREMENTS:
 Must link with C standard library
+Concurrent pools need C11 atomics
+Virtual memory functions use POSIX mmap()/mprotect()
 
 */
 
 #include "wrm/common.h"
+#include <stdatomic.h>
 
 /* --- Compile-time Constants ---------------------------------------------- */
 
 #define WRM_MEMORY_GROWTH_FACTOR 2
 #define WRM_POOL_MAX_CAPACITY UINT32_MAX
+// number of pools that can be registered for `wrm_deref()` at once
+#define WRM_MEMORY_MAX_POOLS 256
+// number of containers that can be tracked for statistics at once
+#define WRM_MEMORY_MAX_TRACKED 64
+// id of a pool that could not be registered
+#define WRM_POOL_NO_ID UINT32_MAX
+// end of a concurrent pool's free list; also marks freed slots in a compaction remap table
+#define WRM_POOL_NO_SLOT UINT32_MAX
+// number of index fields and hooks that can be updated when a pool is compacted
+#define WRM_POOL_MAX_REMAPS 8
+// define WRM_TREE_CHECK_CYCLES to have `wrm_Tree_addChild()` refuse links that would form a cycle;
+// that walks up every ancestor of the parent, so adds are O(depth) instead of O(1) while it is defined
+// number of field arrays a structure-of-arrays pool can have
+#define WRM_SOA_MAX_FIELDS 8
+// slab allocator size classes: powers of two from the min to the max size
+#define WRM_SLAB_MIN_SIZE 16
+#define WRM_SLAB_MAX_SIZE 4096
+#define WRM_SLAB_CLASS_CNT 9
+// bytes in each slab that size classes are carved from
+#define WRM_SLAB_BYTES (64 * 1024)
+// slots whose control bytes a map compares at once while probing
+#define WRM_MAP_GROUP_SIZE 16
+// control bytes of map slots that hold no entry; taken slots hold 7 bits of their key's hash instead
+#define WRM_MAP_EMPTY 0x80
+#define WRM_MAP_DELETED 0xFE
+// assumed size of a cache line, to keep data written by different threads apart
+#define WRM_CACHE_LINE 64
+// bits of a sort key each radix sort pass orders by
+#define WRM_SORT_RADIX_BITS 8
+// number of 64-bit words needed for a bit vector of `n` bits
+#define wrm_BIT_WORDS(n) (((n) + 63) / 64)
 
 /* --- Type declarations --------------------------------------------------- */
 
-// represents a safe reference to an object
-typedef struct wrm_Ref
-wrm_Ref;
+// represents a source of memory, as a table of functions plus user context
+typedef struct wrm_Allocator
+wrm_Allocator;
+// an allocator that counts what passes through it on the way to another allocator
+typedef struct wrm_Tracking_Allocator
+wrm_Tracking_Allocator;
+// an allocator of small objects sorted into size classes
+typedef struct wrm_Slab_Allocator
+wrm_Slab_Allocator;
+
+// kinds of container the statistics registry knows how to read
+typedef enum wrm_Memory_Kind {
+    WRM_MEMORY_POOL,
+    WRM_MEMORY_STACK,
+    WRM_MEMORY_ARENA,
+    WRM_MEMORY_FRAME_ARENA
+} wrm_Memory_Kind;
+// a snapshot of how much memory a container uses and how it got there
+typedef struct wrm_Memory_Stats
+wrm_Memory_Stats;
+
+// index of an element in a pool or stack
+typedef u32 wrm_Handle;
 // represents a pool allocator
-typedef struct wrm_Pool 
+typedef struct wrm_Pool
 wrm_Pool;
+// something to update when a pool's items move to new slots: an index field or a hook
+typedef struct wrm_Pool_Remap
+wrm_Pool_Remap;
+// a copy of the state of a pool, to be restored later
+typedef struct wrm_Pool_Snapshot
+wrm_Pool_Snapshot;
+// represents a pool whose elements are split into parallel arrays, one per field
+typedef struct wrm_Soa_Pool
+wrm_Soa_Pool;
+// represents a fixed-capacity pool that is safe to use from several threads at once
+typedef struct wrm_Concurrent_Pool
+wrm_Concurrent_Pool;
+// represents a fixed-capacity queue of elements handed from producer threads to one consumer thread
+typedef struct wrm_Ring
+wrm_Ring;
+// a run of consecutive ring elements, reserved for writing or peeked for reading in place
+typedef struct wrm_Ring_Span
+wrm_Ring_Span;
 // represents a continually-growing stack of elements: may be used as an arena, only reset on a manual call to reset()
-typedef struct wrm_Stack 
-wrm_Stack; 
+typedef struct wrm_Stack
+wrm_Stack;
+// represents a linear allocator of bytes: pushes are bump allocations, released only by rolling back to a marker
+typedef struct wrm_Arena
+wrm_Arena;
+// a saved position in an arena to roll back to
+typedef size_t wrm_Arena_Marker;
+// a copy of the elements of a stack, to be restored later
+typedef struct wrm_Stack_Snapshot
+wrm_Stack_Snapshot;
+// two arenas used on alternating frames
+typedef struct wrm_Frame_Arena
+wrm_Frame_Arena;
+// node data to be embedded in elements of a pool that are part of a tree
+typedef struct wrm_Tree_Node
+wrm_Tree_Node;
+// represents parent/child associations between the elements of a pool
+typedef struct wrm_Tree
+wrm_Tree;
+// a copy of the flattened arrays of a tree, to be restored later
+typedef struct wrm_Tree_Snapshot
+wrm_Tree_Snapshot;
+// walks a subtree in pre- or post-order, keeping its path in an arena
+typedef struct wrm_Tree_Iter
+wrm_Tree_Iter;
+// represents an associative array from keys to values of known sizes, with open addressing
+typedef struct wrm_Map
+wrm_Map;
+// a sort key and the index of the record it belongs to
+typedef struct wrm_Sort_Key
+wrm_Sort_Key;
 
 /* --- Type definitions ---------------------------------------------------- */
 
-struct wrm_Ref {
-    u32 idx;
-    u32 src;
+wrm_OPTION(wrm_Handle, Handle);
+wrm_OPTION(wrm_Ref, Ref);
+
+#define OPTION_SOME(t_name, v) wrm_SOME(t_name, v)
+#define OPTION_NONE(t_name) wrm_NONE(t_name)
+
+struct wrm_Allocator {
+    wrm_FUNC(alloc, void*, void *ctx, size_t size); // must return zeroed memory, or NULL on failure
+    wrm_FUNC(realloc, void*, void *ctx, void *ptr, size_t old_size, size_t new_size); // bytes past `old_size` are uninitialized
+    wrm_FUNC(free, void, void *ctx, void *ptr, size_t size);
+    void *ctx; // passed to each function
 };
 
-wrm_OPTION(wrm_Ref, wrm_Ref);
+struct wrm_Tracking_Allocator {
+    wrm_Allocator allocator; // give this to containers
+    const wrm_Allocator *parent; // where memory actually comes from (NULL for the C heap)
+    const char *name; // used in `wrm_Tracking_Allocator_print()`
+
+    size_t bytes; // bytes currently allocated
+    size_t peak; // highest `bytes` reached
+    size_t alloc_cnt;
+    size_t realloc_cnt;
+    size_t free_cnt;
+};
+
+struct wrm_Slab_Allocator {
+    wrm_Allocator allocator; // give this to containers
+    const wrm_Allocator *parent; // source of objects over `WRM_SLAB_MAX_SIZE` and the slab list (NULL for the C heap)
+
+    void *free_lists[WRM_SLAB_CLASS_CNT]; // freed blocks of each class, linked through their first bytes
+    u8 *next[WRM_SLAB_CLASS_CNT]; // next never-used block of each class
+    u8 *end[WRM_SLAB_CLASS_CNT]; // end of the slab `next` is carved from
+
+    void **slabs; // every slab, released on delete
+    size_t slab_cnt;
+    size_t slab_cap;
+};
+
+struct wrm_Memory_Stats {
+    const char *name; // name it was tracked under, or NULL
+    wrm_Memory_Kind kind;
+    size_t e_size; // size in bytes of each element (1 for arenas)
+    size_t cap; // elements there is room for (bytes committed for arenas)
+    size_t len; // live elements (bytes pushed for arenas)
+    size_t peak; // highest `len` reached
+    size_t realloc_cnt; // number of resizes (page commits for arenas, which never move)
+    size_t realloc_bytes; // bytes of existing data carried over by resizes
+};
+
+struct wrm_Pool_Remap {
+    wrm_Pool *owner; // index fields: pool whose elements hold the field (may be the compacted pool itself)
+    size_t offset; // index fields: offset of the u32 slot index in each element of `owner`
+    wrm_FUNC(hook, void, void *ctx, const u32 *remap, size_t len); // hooks: called with the whole remap table instead
+    void *ctx; // hooks: passed to `hook`
+};
 
 struct wrm_Pool {
-    void *items; // source array of elements
-    u8 *in_use; // bit vector to track which slots are available
+    void *data; // source array of elements
+    u64 *in_use; // bit vector tracking which slots are taken
+    u32 *free_slots; // stack of released slots, reused most-recent first
+    u32 *gens; // generation of each slot: odd while in use, bumped on every get and free
+    u32 *packed_at; // dense pools only (NULL otherwise): position in `data` of each slot's item
+    u32 *slot_of; // dense pools only: slot of each item in `data`
 
-    size_t item_size; // size in bytes of each slot/item
+    size_t e_size; // size in bytes of each slot/item
     size_t cap; // number of total slots for items in the pool
-    size_t used; // number of slots that are taken up
+    size_t used_cnt; // number of slots that are taken up
+    size_t free_cnt; // number of slots on the free stack
+    size_t top; // slots at or beyond this index have never been handed out
+    size_t max_cap; // virtual pools only (0 otherwise): slots reserved in address space for `data`
+
+    wrm_Pool_Remap remaps[WRM_POOL_MAX_REMAPS]; // updated by `wrm_Pool_compact()`
+    u32 remap_cnt;
+    u32 gen_base; // generation that new slots start at; raised past slots dropped by a shrink
+
+    u64 *dirty; // bit vector of the elements of `data` written since `dirty_epoch`; NULL until a snapshot tracks them
+    u32 dirty_epoch; // tracked snapshot whose elements the clean ones of `data` still match, 0 for none
+    u32 snapshot_cnt; // tracked snapshots taken so far, numbering them from 1
+
+    u32 id; // `src` of references to this pool
+    const wrm_Allocator *allocator; // source of all the arrays except a virtual pool's `data`
+
+    bool auto_reserve; // whether the memory can be resized with realloc()
+
+    // counters
+    size_t peak; // highest `used_cnt` reached
+    size_t realloc_cnt; // number of times the arrays were resized
+    size_t realloc_bytes; // bytes of existing data carried over by those resizes
+};
+
+struct wrm_Soa_Pool {
+    wrm_Pool slots; // slot bookkeeping; its `data` is field 0
+    u8 *fields[WRM_SOA_MAX_FIELDS]; // one array of `cap` values per field
+    size_t sizes[WRM_SOA_MAX_FIELDS]; // size in bytes of each field's values
+    u32 field_cnt;
+
+    bool auto_reserve; // whether the field arrays can be resized with realloc()
+};
+
+struct wrm_Pool_Snapshot {
+    u8 *block; // the single allocation holding the arrays below
+    size_t block_size;
+    const wrm_Allocator *allocator;
+
+    u8 *data; // the first `top` elements of the pool's data (`used_cnt` for dense pools)
+    u64 *in_use;
+    u32 *gens;
+    u32 *free_slots; // the first `free_cnt` are meaningful
+    u32 *packed_at; // dense pools only (NULL otherwise)
+    u32 *slot_of;
+
+    size_t e_size;
+    size_t cap;
+    size_t used_cnt;
+    size_t free_cnt;
+    size_t top;
+    u32 gen_base;
+    u32 epoch; // number of this snapshot among the pool's tracked ones, or 0 if untracked
+};
+
+struct wrm_Concurrent_Pool {
+    void *data; // source array of elements
+    _Atomic u32 *next_free; // free list links: the slot freed before each free slot
+    _Atomic u32 *gens; // generation of each slot: odd while in use, bumped on every get and free
+
+    _Atomic u64 free_head; // top of the free list in the low 32 bits, tagged with a change count in the high 32
+    _Atomic u32 top; // slots at or beyond this index have never been handed out
+    _Atomic size_t used_cnt;
+
+    size_t e_size; // size in bytes of each slot/item
+    size_t cap; // number of total slots; never grows
+    const wrm_Allocator *allocator;
+};
+
+struct wrm_Ring {
+    u8 *data; // source array of elements
+    size_t e_size; // size in bytes of each element
+    u64 cap; // number of elements; a power of two
+    u64 mask; // `cap - 1`, to turn positions into indices
+    bool multi_producer; // whether several threads may push at once
+    const wrm_Allocator *allocator;
+
+    _Atomic u32 *ready; // multi producer only: each element's position + 1 (truncated) once committed
 
-    u32 id; // id for indices
+    // producer side; positions only ever increase
+    _Alignas(WRM_CACHE_LINE) _Atomic u64 head; // next position to reserve
+    _Atomic u64 published; // single producer only: positions before this are committed and can be read
+    u64 tail_cache; // single producer only: the last `tail` seen, to avoid reading the consumer's line
 
-    bool final; // whether the memory can be resized with realloc()
+    // consumer side
+    _Alignas(WRM_CACHE_LINE) _Atomic u64 tail; // next position to read
+    u64 published_cache; // single producer only: the last `published` seen, to avoid reading the producer's line
+    _Alignas(WRM_CACHE_LINE) u8 pad; // keep whatever follows off the consumer's line
+};
+
+struct wrm_Ring_Span {
+    u8 *data; // first element of the span, contiguous in memory
+    u64 pos; // position of the first element
+    size_t cnt; // number of elements; 0 if nothing could be reserved or read
 };
 
 struct wrm_Stack {
     void *data; // source array of elements
 
-    size_t item_size; // size in bytes of each item in the stack
+    size_t e_size; // size in bytes of each item in the stack
     size_t cap;
     size_t len;
+    size_t max_cap; // virtual stacks only (0 otherwise): items reserved in address space for `data`
+    const wrm_Allocator *allocator; // source of `data`, unless the stack is virtual
+
+    bool auto_reserve; // whether the memory can be resized with realloc()
+
+    // counters
+    size_t peak; // highest `len` reached
+    size_t realloc_cnt; // number of times `data` was resized
+    size_t realloc_bytes; // bytes of existing elements carried over by those resizes
+};
+
+struct wrm_Stack_Snapshot {
+    u8 *data; // the first `len` elements of the stack
+    size_t size; // bytes allocated for `data`
+    size_t len;
+    const wrm_Allocator *allocator;
+};
+
+struct wrm_Arena {
+    wrm_Allocator allocator; // give this to containers; frees only give back the most recent allocation
+    u8 *data; // start of the reserved address range
+
+    size_t pos; // offset of the next free byte
+    size_t cap; // bytes committed
+    size_t max_cap; // bytes reserved
+
+    // counters
+    size_t peak; // highest `pos` reached
+    size_t push_cnt; // number of pushes
+    size_t commit_cnt; // number of times more pages had to be committed; flat in a steady state
+};
+
+struct wrm_Frame_Arena {
+    wrm_Arena arenas[2];
+    u32 curr; // index of the arena for the current frame
+    u64 frame; // number of swaps so far
+};
+
+/*
+A zeroed node is a valid root with no children; each link is only meaningful
+when the counts/flags say so: `parent` if `has_parent`, `first_child` and
+`last_child` if `child_cnt > 0`, and the sibling links while the node is not
+at the respective end of its parent's child list
+*/
+struct wrm_Tree_Node {
+    u32 parent;
+    u32 first_child;
+    u32 last_child;
+    u32 next_sibling;
+    u32 prev_sibling;
+    u32 child_cnt;
+    bool has_parent;
+};
+
+struct wrm_Tree {
+    wrm_Pool *src; // pool containing the elements of the tree
+    size_t offset; // offset of the wrm_Tree_Node within each element of `src`
 
-    u32 id; // id for indices
+    // flattened trees only (NULL/0 otherwise), valid after `wrm_Tree_flatten()`
+    u32 *order; // slot of every node, in pre-order: each subtree is a contiguous run starting at its root
+    u32 *parent_pos; // position in `order` of each node's parent, or `WRM_POOL_NO_SLOT` for roots
+    u32 *subtree_len; // number of nodes in each node's subtree, itself included
+    size_t flat_len; // number of nodes in `order`
+    size_t flat_cap;
+    const wrm_Allocator *allocator; // source of the flattened arrays
 
-    bool reserve; // whether the memory can be resized with realloc()
+    bool flat; // whether the tree keeps the flattened arrays
+    bool stale; // whether the topology changed since the arrays were last built
+};
+
+struct wrm_Tree_Snapshot {
+    u32 *order; // start of a block of `3 * flat_cap` u32s, like the tree's own arrays
+    size_t flat_len;
+    size_t flat_cap;
+    const wrm_Allocator *allocator;
+    bool stale; // whether the tree's arrays were out of date when copied; if so none were
+};
+
+struct wrm_Tree_Iter {
+    wrm_Tree *tree;
+    wrm_Arena *arena; // holds `path`
+    u32 *path; // ancestors of `node`, outermost first
+    u32 depth; // number of ancestors of `node` on `path`, 0 for `root`
+    u32 path_cap;
+
+    u32 root; // node the walk started from
+    u32 node; // node returned last
+
+    bool post; // whether children come before their parent
+    bool started;
+    bool done;
+    bool descend; // pre-order only: whether the children of `node` are visited next
+    bool overflow; // the arena ran out of room for `path`, ending the walk early
+};
+
+struct wrm_Map {
+    u8 *ctrl; // control byte of each slot: `WRM_MAP_EMPTY`, `WRM_MAP_DELETED`, or the low 7 bits of its key's hash
+    u8 *keys; // `cap` keys of `key_size` bytes
+    u8 *values; // `cap` values of `value_size` bytes
+
+    size_t key_size;
+    size_t value_size;
+    size_t cap; // number of slots: a power of two, and a whole number of groups
+    size_t len; // number of entries
+    size_t deleted_cnt; // removed slots that were not reused yet; they still lengthen probes
+
+    wrm_FUNC(hash, u64, const void *key, size_t size);
+    wrm_FUNC(equals, bool, const void *a, const void *b, size_t size);
+    const wrm_Allocator *allocator; // source of the single block holding the three arrays
+};
+
+struct wrm_Sort_Key {
+    u64 key;
+    u32 idx;
 };
 
 /* --- Function declarations ----------------------------------------------- */
 
+// allocator
+
+// the C heap: calloc(), realloc() and free()
+extern const wrm_Allocator wrm_heap_allocator;
+/* Get `size` zeroed bytes from allocator `a` (the C heap if NULL) */
+inline void *wrm_alloc(const wrm_Allocator *a, size_t size)
+{
+    if(!a) { a = &wrm_heap_allocator; }
+    return a->alloc(a->ctx, size);
+}
+/* Resize `ptr`, allocated from `a` with `old_size` bytes, to `new_size` bytes */
+inline void *wrm_realloc(const wrm_Allocator *a, void *ptr, size_t old_size, size_t new_size)
+{
+    if(!a) { a = &wrm_heap_allocator; }
+    return a->realloc(a->ctx, ptr, old_size, new_size);
+}
+/* Give `ptr`, allocated from `a` with `size` bytes, back to `a`; does nothing if `ptr` is NULL */
+inline void wrm_free(const wrm_Allocator *a, void *ptr, size_t size)
+{
+    if(!ptr) { return; }
+    if(!a) { a = &wrm_heap_allocator; }
+    a->free(a->ctx, ptr, size);
+}
+/*
+Initialize tracking allocator `t` that forwards to `parent` (the C heap if NULL)
+Pass `&t->allocator` wherever an allocator is accepted
+*/
+void wrm_Tracking_Allocator_init(wrm_Tracking_Allocator *t, const char *name, const wrm_Allocator *parent);
+/* Print the counters of tracking allocator `t` to `stdout` */
+void wrm_Tracking_Allocator_print(const wrm_Tracking_Allocator *t);
+/*
+Initialize slab allocator `s`
+Objects up to `WRM_SLAB_MAX_SIZE` bytes come from slabs; larger ones from `parent`
+(the C heap if NULL)
+Pass `&s->allocator` wherever an allocator is accepted
+Slabs are never given back before `wrm_Slab_Allocator_delete()`, so memory use
+only grows to the peak of each size class
+*/
+void wrm_Slab_Allocator_init(wrm_Slab_Allocator *s, const wrm_Allocator *parent);
+/* Get the size class of a `size` byte object */
+inline u32 wrm_Slab_class(size_t size)
+{
+    return size <= WRM_SLAB_MIN_SIZE ? 0 : 64 - __builtin_clzll((u64)size - 1) - 4;
+}
+/*
+Release every slab of slab allocator `s`
+All objects it handed out up to `WRM_SLAB_MAX_SIZE` bytes are invalid after this;
+larger ones must have been freed already
+*/
+void wrm_Slab_Allocator_delete(wrm_Slab_Allocator *s);
+
+
 // cast generic data member to pointer to type
 #define wrm_data_AS(buf, t) ((t*)((buf).data))
-/* 
-helper to get the value at a position in a bit vector 
-*/ 
-inline bool wrm_bitAt(u8 *bit_vec, u32 idx)
+/*
+helper to get the value at a position in a bit vector
+*/
+inline bool wrm_bitAt(const u64 *bit_vec, u32 idx)
 {
-    // TODO: implement
+    return (bit_vec[idx >> 6] >> (idx & 63)) & 1;
 }
+/* helper to set the value at a position in a bit vector */
+inline void wrm_bitSet(u64 *bit_vec, u32 idx, bool val)
+{
+    if(val) { bit_vec[idx >> 6] |= (u64)1 << (idx & 63); }
+    else { bit_vec[idx >> 6] &= ~((u64)1 << (idx & 63)); }
+}
+/*
+Find the first set bit at or after `idx` in a bit vector of `len` bits
+Skips whole empty words using count-trailing-zeros
+Returns `len` if there is none
+*/
+inline u32 wrm_bitNext(const u64 *bit_vec, u32 idx, u32 len)
+{
+    if(idx >= len) { return len; }
+    u32 w = idx >> 6;
+    u64 word = bit_vec[w] & (~(u64)0 << (idx & 63)); // drop bits before idx
+    u32 words = wrm_BIT_WORDS(len);
 
+    while(!word) {
+        if(++w == words) { return len; }
+        word = bit_vec[w];
+    }
+    u32 found = (w << 6) + (u32)__builtin_ctzll(word);
+    return found < len ? found : len;
+}
+/*
+Get a pointer to the object referred to by `ref`
+Returns NULL if its pool no longer exists or the slot was freed since `ref` was made
+*/
 void *wrm_deref(wrm_Ref ref);
 
 
+// memory statistics
+
+/*
+Track `container`, of type `kind`, under `name` for `wrm_memoryDump()` and `wrm_memoryReportLeaks()`
+`name` is not copied, so it must outlive the tracking; tracking a container again renames it
+Deleting the container untracks it
+Returns `false` if `WRM_MEMORY_MAX_TRACKED` containers are tracked already
+*/
+bool wrm_memoryTrack(const char *name, wrm_Memory_Kind kind, const void *container);
+/* Stop tracking `container`; does nothing if it is not tracked */
+void wrm_memoryUntrack(const void *container);
+/*
+Take the current live count of tracked `container` as what it is expected to
+still hold at shutdown, such as default resources made at startup
+*/
+void wrm_memoryExpect(const void *container);
+/* Get the statistics of `container` of type `kind`, whether or not it is tracked */
+wrm_Memory_Stats wrm_memoryStats(wrm_Memory_Kind kind, const void *container);
+/* Print the statistics of every tracked container to `f`, as an aligned table or as a JSON array */
+void wrm_memoryDump(FILE *f, bool json);
+/*
+Report an error (through `wrm_error`) if tracked `container` holds more live elements than expected
+Returns the number of leaked elements
+*/
+size_t wrm_memoryReportLeaks(const void *container);
+
+
+// virtual memory
+
+/* Get the size in bytes of a page of memory */
+size_t wrm_pageSize(void);
+/* Round `bytes` up to a whole number of pages */
+inline size_t wrm_pageRound(size_t bytes)
+{
+    size_t page = wrm_pageSize();
+    return (bytes + page - 1) / page * page;
+}
+/*
+Reserve (but do not commit) `bytes` of address space
+Returns NULL on failure
+The range cannot be accessed until it is committed with `wrm_virtualCommit()`
+*/
+void *wrm_virtualReserve(size_t bytes);
+/*
+Commit the first `bytes` (rounded up to a page) of a reserved range at `base`
+Returns `true` if the operation was successful
+Newly committed memory reads as zero
+*/
+bool wrm_virtualCommit(void *base, size_t bytes);
+/* Decommit the pages of the range at `base` from byte `from` (rounded up to a page) to byte `to` */
+void wrm_virtualDecommit(void *base, size_t from, size_t to);
+/* Release a range of `bytes` reserved with `wrm_virtualReserve()` */
+void wrm_virtualRelease(void *base, size_t bytes);
+
 
 // pool
 
-/* 
-Initialize a pool of `capacity` elements of `element_size` bytes each
+/*
+Initialize a pool with room for `capacity` elements of `element_size` bytes each
+Returns `true` if the operation was successful; on failure, anything it got is already released
+`auto_reserve` determines whether the pool will automatically allocate space for new elements
+All memory comes from `allocator`, or the C heap if it is NULL
+*/
+bool wrm_Pool_init(wrm_Pool *p, size_t capacity, size_t element_size, bool auto_reserve, const wrm_Allocator *allocator);
+/*
+Initialize a dense pool: same as `wrm_Pool_init()`, but the `used_cnt` live
+items are always packed at the front of `data`, in no particular order
+Walk them with `wrm_Pool_packedAt()`, and get each one's slot from `slot_of`
+IMPORTANT: freeing a slot moves the last item into the hole, so pointers into
+a dense pool are only good until the next free
+*/
+bool wrm_Pool_initDense(wrm_Pool *p, size_t capacity, size_t element_size, bool auto_reserve, const wrm_Allocator *allocator);
+/*
+Initialize a virtual pool: reserves address space for `max_capacity` elements
+of `element_size` bytes each, and commits room for `capacity` of them
+Grows automatically up to `max_capacity` without copying elements, so pointers
+from `wrm_Pool_at()` stay valid until their slot is freed
+Returns `true` if the operation was successful
+Only the pool's bookkeeping comes from `allocator`
+*/
+bool wrm_Pool_initVirtual(wrm_Pool *p, size_t capacity, size_t max_capacity, size_t element_size, const wrm_Allocator *allocator);
+/*
+Get an available slot (index of an element) from pool `p`; the slot is zeroed
+Reuses the most recently freed slot if there is one
+*/
+wrm_Option_Handle wrm_Pool_getSlot(wrm_Pool *p);
+/*
+Ensure that pool `p` has room for `capacity` total elements
 Returns `true` if the operation was successful
-`reserve` determines whether the pool will automatically allocate space for new elements 
 */
-bool wrm_initPool(
-    wrm_Pool *p,
-    void *mem,
-    size_t element_capacity, 
-    size_t element_size, 
-    bool final
-);
-/* 
-Get an available slot (index of an element) from pool `p` 
+bool wrm_Pool_reserve(wrm_Pool *p, size_t capacity);
+/*
+Shrink pool `p` to `capacity` slots, compacting it first with `wrm_Pool_compact()`
+Returns `true` if the operation was successful
+IMPORTANT: elements may end up at new indices; see `wrm_Pool_compact()`
 */
-wrm_Ref wrm_poolAlloc(wrm_Pool *p);
-/* 
-Free a slot from the pool
+bool wrm_Pool_shrink(wrm_Pool *p, size_t capacity);
+/*
+Register a u32 field, `offset` bytes into each element of pool `owner`, that holds
+a slot index of pool `p`; compacting `p` rewrites it
+Values that are not slots of `p` (such as `WRM_POOL_NO_SLOT`) are left alone
+Returns `false` if `p` already has `WRM_POOL_MAX_REMAPS` fields and hooks
 */
-void wrm_poolFree(wrm_Ref *ref);
-
-// --- STACK 
-
+bool wrm_Pool_addIndexField(wrm_Pool *p, wrm_Pool *owner, size_t offset);
 /*
-Initialize 
+Register `hook` to be called with the remap table whenever pool `p` is
+compacted, for indices that a plain field cannot describe
+Returns `false` if `p` already has `WRM_POOL_MAX_REMAPS` fields and hooks
 */
-bool wrm_initStack(wrm_Stack *s, void *mem, size_t mem_size, bool final);
-/* 
-Release the slot at `idx` for reuse, if it wasn't already available, in pool `p` 
+bool wrm_Pool_addRemapHook(wrm_Pool *p, wrm_FUNC(hook, void, void *ctx, const u32 *remap, size_t len), void *ctx);
+/* Remove every index field of pool `p` held by `key` (as the owner pool) and every hook with `key` as its context */
+void wrm_Pool_removeRemaps(wrm_Pool *p, const void *key);
+/*
+Move every live item of pool `p` to slots 0 through `used_cnt - 1`, keeping
+their order (packed order for dense pools, whose items do not move in memory),
+then update all registered index fields and hooks
+If `remap` is not NULL it must have room for `p->top` entries, and receives
+each old slot's new slot (`WRM_POOL_NO_SLOT` for free slots)
+References to moved items go stale; references to items that stayed put do not
+Returns `true` if the operation was successful
+*/
+bool wrm_Pool_compact(wrm_Pool *p, u32 *remap);
+/*
+Copy the full state of pool `p` into `snap`, which must be zeroed or hold an
+earlier snapshot; an earlier snapshot's memory is reused if it is big enough
+If `track` is true, `p` starts marking the elements written from now on, so
+that restoring this snapshot can copy only those; tracking a new snapshot
+ends the tracking of the previous one
+Memory comes from the pool's allocator
+Returns `true` if the operation was successful
 */
-inline void wrm_Pool_freeSlot(wrm_Pool *p, wrm_Index idx)
+bool wrm_Pool_snapshot(wrm_Pool *p, wrm_Pool_Snapshot *snap, bool track);
+/*
+Put pool `p` back in the state saved in `snap`: elements, occupancy, free list,
+and the generations of the slots that were live then, so references to those
+resolve again; slots that were free keep their current generation, so that
+references taken after the snapshot never resolve to a later item
+If `delta` is true and `snap` is the snapshot `p` is tracking, only the
+elements marked as written are copied back; the u32-per-slot bookkeeping is
+always copied whole. Otherwise every element is copied
+IMPORTANT: elements written through `wrm_Pool_slotData()` or `wrm_Pool_packedAt()`
+must be marked with `wrm_Pool_touch()`, or a delta restore will miss them
+Returns `true` if the operation was successful
+*/
+bool wrm_Pool_restore(wrm_Pool *p, const wrm_Pool_Snapshot *snap, bool delta);
+/* Release the memory of pool snapshot `snap` */
+void wrm_Pool_Snapshot_delete(wrm_Pool_Snapshot *snap);
+/* Checks that `idx` refers to a slot that is in use in pool `p` */
+inline bool wrm_Pool_isValid(wrm_Pool *p, wrm_Handle idx)
+{
+    return p && idx < p->cap && wrm_bitAt(p->in_use, idx);
+}
+/* Get a pointer to the data of slot `idx` in pool `p` without any checks */
+inline void *wrm_Pool_slotData(wrm_Pool *p, wrm_Handle idx)
+{
+    return (u8*)p->data + (p->packed_at ? p->packed_at[idx] : idx) * p->e_size;
+}
+/* Get the item at position `pos` (< `used_cnt`) of dense pool `p` without any checks */
+inline void *wrm_Pool_packedAt(wrm_Pool *p, u32 pos)
+{
+    return (u8*)p->data + pos * p->e_size;
+}
+/* Get the first in-use slot at or after `idx`; returns `p->top` if there is none */
+inline u32 wrm_Pool_nextUsed(wrm_Pool *p, u32 idx)
+{
+    return wrm_bitNext(p->in_use, idx, p->top);
+}
+/*
+Loop over the index `i` of each in-use slot of pool `p`, in order
+Each step finds the next set bit of the occupancy words, skipping empty words entirely
+The current slot may be freed in the body, but no other slots should be gotten or freed
+*/
+#define wrm_Pool_FOR_EACH(p, i) \
+    for(u32 i = wrm_Pool_nextUsed((p), 0); i < (p)->top; i = wrm_Pool_nextUsed((p), i + 1))
+/*
+Mark the element at slot `idx` of pool `p` as written, for delta restores
+`wrm_Pool_at()`, `wrm_Pool_offsetAt()` and `wrm_Pool_deref()` do this already
+*/
+inline void wrm_Pool_touch(wrm_Pool *p, wrm_Handle idx)
+{
+    if(p->dirty) { wrm_bitSet(p->dirty, p->packed_at ? p->packed_at[idx] : idx, true); }
+}
+/*
+Release the slot at `idx` for reuse, if it wasn't already available, in pool `p`
+Any references to the slot become stale
+*/
+inline void wrm_Pool_freeSlot(wrm_Pool *p, wrm_Handle idx)
 {
     if(!wrm_Pool_isValid(p, idx)) { return; }
-    p->in_use[idx.val] = false;
-    p->used--;
+    wrm_bitSet(p->in_use, idx, false);
+    p->gens[idx]++;
+    p->free_slots[p->free_cnt++] = idx;
+    p->used_cnt--;
+
+    // dense pools: fill the hole with the last item
+    if(p->packed_at) {
+        u32 hole = p->packed_at[idx];
+        u32 last = p->used_cnt;
+        if(hole != last) {
+            memcpy(wrm_Pool_packedAt(p, hole), wrm_Pool_packedAt(p, last), p->e_size);
+            if(p->dirty) { wrm_bitSet(p->dirty, hole, true); }
+            p->slot_of[hole] = p->slot_of[last];
+            p->packed_at[p->slot_of[hole]] = hole;
+        }
+    }
+}
+/* Make a reference to the slot at `idx` in pool `p`; check `exists` before using it */
+inline wrm_Option_Ref wrm_Pool_getRef(wrm_Pool *p, wrm_Handle idx)
+{
+    if(!wrm_Pool_isValid(p, idx)) { return OPTION_NONE(Ref); }
+    return OPTION_SOME(Ref, ((wrm_Ref){ .src = p->id, .idx = idx, .gen = p->gens[idx] }));
+}
+/*
+Get a pointer to the object referred to by `ref` in pool `p`
+Returns NULL if the slot was freed since `ref` was made: a slot's generation
+is only odd while it is in use, so comparing generations checks both
+Does not check `ref.src`; use `wrm_deref()` for that
+*/
+inline void *wrm_Pool_deref(wrm_Pool *p, wrm_Ref ref)
+{
+    if(!(ref.idx < p->cap && p->gens[ref.idx] == ref.gen && (ref.gen & 1))) { return NULL; }
+    wrm_Pool_touch(p, ref.idx);
+    return wrm_Pool_slotData(p, ref.idx);
+}
+/* Same as `wrm_Pool_deref()`, but read-only: nothing is written, so threads may share a pool that is not changing */
+inline const void *wrm_Pool_peekRef(wrm_Pool *p, wrm_Ref ref)
+{
+    if(!(ref.idx < p->cap && p->gens[ref.idx] == ref.gen && (ref.gen & 1))) { return NULL; }
+    return wrm_Pool_slotData(p, ref.idx);
 }
 /* Get a safe void* to a location `offset` bytes from the start of the element at `idx`; returns NULL if `p` is NULL, `idx` is invalid, or `offset` is too big */
-inline void *wrm_Pool_offsetAt(wrm_Pool *p, wrm_Index idx, size_t offset)
+inline void *wrm_Pool_offsetAt(wrm_Pool *p, wrm_Handle idx, size_t offset)
 {
-    return (wrm_Pool_isValid(p, idx) && (offset < p->item_size))  ? (u8*)p->data + idx.val * p->item_size + offset : NULL;
+    if(!wrm_Pool_isValid(p, idx) || offset >= p->e_size) { return NULL; }
+    wrm_Pool_touch(p, idx);
+    return (u8*)wrm_Pool_slotData(p, idx) + offset;
 }
 /* Get a safe void* to a location in a pool; returns NULL if `p` is NULL or `idx` is invalid (out-of-bounds or freed slot) */
-inline void *wrm_Pool_at(wrm_Pool *p, wrm_Index idx)
+inline void *wrm_Pool_at(wrm_Pool *p, wrm_Handle idx)
 {
     return wrm_Pool_offsetAt(p, idx, 0);
 }
-/* 
+/* Same as `wrm_Pool_at()`, but read-only, so the element is not marked as written */
+inline const void *wrm_Pool_peek(wrm_Pool *p, wrm_Handle idx)
+{
+    return wrm_Pool_isValid(p, idx) ? wrm_Pool_slotData(p, idx) : NULL;
+}
+/*
 Release the resources associated with pool `p`
 Iterates over the pool contents
 If `delete()` is not null, it is called on each in-use element
 After iteration, frees the pool's memory
-`p` is no longer considered usable after this point  
+`p` is no longer considered usable after this point
 */
-void wrm_Pool_delete(wrm_Pool *p, wrm_FUNCTION(delete, void, void *element));
+void wrm_Pool_delete(wrm_Pool *p, wrm_FUNC(delete, void, void *element));
+
+
+// structure-of-arrays pool
+
+/*
+Initialize a structure-of-arrays pool with room for `capacity` elements, made
+of `field_cnt` (at most `WRM_SOA_MAX_FIELDS`) fields of `field_sizes[f]` bytes
+Each field is kept in its own array, indexed by the element's slot
+Field 0 is the data of `s->slots`, so a tree or index field can be built over
+`&s->slots` when field 0 holds it
+All memory comes from `allocator`, or the C heap if it is NULL
+Returns `true` if the operation was successful
+*/
+bool wrm_Soa_Pool_init(wrm_Soa_Pool *s, size_t capacity, const size_t *field_sizes, u32 field_cnt, bool auto_reserve, const wrm_Allocator *allocator);
+/* Get an available slot from SoA pool `s`; every field of the slot is zeroed */
+wrm_Option_Handle wrm_Soa_Pool_getSlot(wrm_Soa_Pool *s);
+/*
+Ensure that SoA pool `s` has room for `capacity` total elements
+Returns `true` if the operation was successful
+*/
+bool wrm_Soa_Pool_reserve(wrm_Soa_Pool *s, size_t capacity);
+/*
+Move every live element of SoA pool `s` to slots 0 through `used_cnt - 1`,
+moving all of its fields; see `wrm_Pool_compact()`
+Afterwards each field is a gapless array of `s->slots.used_cnt` values
+*/
+bool wrm_Soa_Pool_compact(wrm_Soa_Pool *s, u32 *remap);
+/* Get field `field` of every slot of SoA pool `s` as an array of type `t` */
+#define wrm_Soa_Pool_ARRAY(s, field, t) ((t*)(s)->fields[field])
+/* Loop over the index `i` of each in-use slot of SoA pool `s`, in order; see `wrm_Pool_FOR_EACH()` */
+#define wrm_Soa_Pool_FOR_EACH(s, i) wrm_Pool_FOR_EACH(&(s)->slots, i)
+/* Get a safe void* to field `field` of the element at `idx`; returns NULL if `s` is NULL, or `idx` or `field` is invalid */
+inline void *wrm_Soa_Pool_at(wrm_Soa_Pool *s, u32 field, wrm_Handle idx)
+{
+    return (s && field < s->field_cnt && wrm_Pool_isValid(&s->slots, idx)) ? s->fields[field] + idx * s->sizes[field] : NULL;
+}
+/* Release the slot at `idx` for reuse in SoA pool `s`, if it wasn't already available */
+inline void wrm_Soa_Pool_freeSlot(wrm_Soa_Pool *s, wrm_Handle idx)
+{
+    wrm_Pool_freeSlot(&s->slots, idx);
+}
+/* Release the memory of SoA pool `s`; `s` is no longer usable after this */
+void wrm_Soa_Pool_delete(wrm_Soa_Pool *s);
+
+
+// concurrent pool
+
+/*
+Initialize a concurrent pool with room for `capacity` elements of `element_size` bytes each
+Returns `true` if the operation was successful
+The pool cannot grow, so `capacity` must cover the most items ever live at once
+Only init and delete are not thread-safe
+*/
+bool wrm_Concurrent_Pool_init(wrm_Concurrent_Pool *p, size_t capacity, size_t element_size, const wrm_Allocator *allocator);
+/*
+Get an available slot, zeroed, from concurrent pool `p` and a reference to it
+Lock-free: retries only when another thread changed the free list at the same time
+*/
+wrm_Option_Ref wrm_Concurrent_Pool_getSlot(wrm_Concurrent_Pool *p);
+/*
+Free the slot `ref` refers to
+Returns `false` if `ref` is stale, so of several threads freeing the same slot only one succeeds
+*/
+bool wrm_Concurrent_Pool_freeSlot(wrm_Concurrent_Pool *p, wrm_Ref ref);
+/*
+Get a pointer to the object `ref` refers to in concurrent pool `p`
+Returns NULL if the slot was freed since `ref` was made
+The pointer is only good while no other thread frees the slot
+*/
+inline void *wrm_Concurrent_Pool_deref(wrm_Concurrent_Pool *p, wrm_Ref ref)
+{
+    if(ref.idx >= p->cap || !(ref.gen & 1)) { return NULL; }
+    return atomic_load_explicit(&p->gens[ref.idx], memory_order_acquire) == ref.gen ? (u8*)p->data + ref.idx * p->e_size : NULL;
+}
+/* Release the memory of concurrent pool `p`; no other thread may be using it */
+void wrm_Concurrent_Pool_delete(wrm_Concurrent_Pool *p);
+
+
+// ring
+
+/*
+Initialize a ring of at least `capacity` elements of `element_size` bytes, rounded up to a power of two
+One thread consumes; if `multi_producer` is false only one thread may produce, otherwise any number can
+Memory comes from `allocator`, or the C heap if it is NULL
+Returns `true` if the operation was successful
+*/
+bool wrm_Ring_init(wrm_Ring *r, size_t capacity, size_t element_size, bool multi_producer, const wrm_Allocator *allocator);
+/*
+Producer: reserve up to `n` free elements of ring `r` to write in place
+The span stops at the end of the array, so it may be shorter; `cnt` is 0 if the ring is full
+Every reserved span must be passed to `wrm_Ring_commit()`, in the order reserved on each thread
+*/
+wrm_Ring_Span wrm_Ring_reserve(wrm_Ring *r, size_t n);
+/*
+Producer: make a reserved span visible to the consumer
+With several producers spans can be committed in any order; the consumer sees each once the spans before it are committed too
+*/
+void wrm_Ring_commit(wrm_Ring *r, wrm_Ring_Span span);
+/* Consumer: get up to `n` committed elements of ring `r` to read in place; stops at the end of the array like `wrm_Ring_reserve()` */
+wrm_Ring_Span wrm_Ring_peek(wrm_Ring *r, size_t n);
+/* Consumer: hand the elements of a peeked span back to the producers */
+void wrm_Ring_release(wrm_Ring *r, wrm_Ring_Span span);
+/* Producer: copy up to `n` elements from `items` into ring `r`; returns how many fit */
+size_t wrm_Ring_push(wrm_Ring *r, const void *items, size_t n);
+/* Consumer: copy up to `n` elements out of ring `r` into `items`; returns how many there were */
+size_t wrm_Ring_pop(wrm_Ring *r, void *items, size_t n);
+/*
+Get the number of elements waiting in ring `r`, counting reserved but uncommitted ones with several producers
+Only a snapshot while other threads are running
+*/
+inline size_t wrm_Ring_len(wrm_Ring *r)
+{
+    // read the tail first: it never passes the head, so the difference cannot wrap
+    u64 tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    return (size_t)(atomic_load_explicit(r->multi_producer ? &r->head : &r->published, memory_order_acquire) - tail);
+}
+/* Release the memory of ring `r`; no thread may be using it */
+void wrm_Ring_delete(wrm_Ring *r);
 
 
 // stack
 
-/* 
+/*
 Initialize a stack with room for `capacity` elements of size `element_size`
 Returns `true` if the operation was successful
-If `auto_reserve` is false you must manually allocate additional capacity with `reserve()` 
+If `auto_reserve` is false you must manually allocate additional capacity with `reserve()`
+All memory comes from `allocator`, or the C heap if it is NULL
+*/
+bool wrm_Stack_init(wrm_Stack *s, size_t capacity, size_t element_size, bool auto_reserve, const wrm_Allocator *allocator);
+/*
+Initialize a virtual stack: reserves address space for `max_capacity` elements
+of `element_size` bytes each, and commits room for `capacity` of them
+Grows automatically up to `max_capacity` without copying elements, so pointers
+from `wrm_Stack_at()` stay valid until the stack is reset below them
+Returns `true` if the operation was successful
 */
-bool wrm_Stack_init(wrm_Stack *s, size_t capacity, size_t element_size, bool auto_reserve);
-/* 
+bool wrm_Stack_initVirtual(wrm_Stack *s, size_t capacity, size_t max_capacity, size_t element_size);
+/*
 Ensure that stack `s` has room for `capacity` total elements
-Returns `true` if the operation was successful 
+Returns `true` if the operation was successful
 */
 bool wrm_Stack_reserve(wrm_Stack *s, size_t capacity);
-/* 
+/*
 If `capacity` is <= the stack's current capacity, shrinks the stack's capacity to use less memory
 Returns `true` if the operation was successful
-Never automatically called 
+Never automatically called
 */
 bool wrm_Stack_shrink(wrm_Stack *s, size_t capacity);
 /*
 Grow's the stack's length by one and returns the index of the top element
 Fails if the stack cannot grow
 */
-wrm_Index wrm_Stack_push(wrm_Stack *s);
+wrm_Option_Handle wrm_Stack_push(wrm_Stack *s);
 /* Roll back stack `s` to `len`; all elements beyond `len` are now considered invalid */
 inline void wrm_Stack_reset(wrm_Stack *s, size_t len)
 {
@@ -183,52 +988,262 @@ inline void wrm_Stack_reset(wrm_Stack *s, size_t len)
     s->len = len;
 }
 /* Get a safe void* to a location `offset` bytes from the start of the element at `idx`; returns NULL if `s` is NULL, `idx` is invalid, or `offset` is too big */
-inline void *wrm_Stack_offsetAt(wrm_Stack *s, wrm_Index idx, size_t offset)
+inline void *wrm_Stack_offsetAt(wrm_Stack *s, wrm_Handle idx, size_t offset)
 {
-    return (s && (idx.val < s->len) && (offset < s->item_size))  ? (u8*)s->data + idx.val * s->item_size + offset : NULL;
+    return (s && (idx < s->len) && (offset < s->e_size))  ? (u8*)s->data + idx * s->e_size + offset : NULL;
 }
 /* Get a safe void* to the location at `idx` in stack `s` returns NULL if `s` is NULL or the index is invalid (beyond top of stack) */
-inline void *wrm_Stack_at(wrm_Stack *s, wrm_Index idx)
+inline void *wrm_Stack_at(wrm_Stack *s, wrm_Handle idx)
 {
     return wrm_Stack_offsetAt(s, idx, 0);
 }
-/* 
+/*
 Release the resources associated with stack `s`
 Iterates over stack contents
-If `delete()` is not null, it is called on each element 
+If `delete()` is not null, it is called on each element
 Then frees the stack memory
-Stack is no longer considered usable after this point 
+Stack is no longer considered usable after this point
+*/
+void wrm_Stack_delete(wrm_Stack *p, wrm_FUNC(delete, void, void*));
+/*
+Copy the elements of stack `s` into `snap`, which must be zeroed or hold an
+earlier snapshot; an earlier snapshot's memory is reused if it is big enough
+Memory comes from the stack's allocator (the C heap for virtual stacks)
+Returns `true` if the operation was successful
+*/
+bool wrm_Stack_snapshot(wrm_Stack *s, wrm_Stack_Snapshot *snap);
+/* Put stack `s` back in the state saved in `snap`; returns `true` if the operation was successful */
+bool wrm_Stack_restore(wrm_Stack *s, const wrm_Stack_Snapshot *snap);
+/* Release the memory of stack snapshot `snap` */
+void wrm_Stack_Snapshot_delete(wrm_Stack_Snapshot *snap);
+
+
+// arena
+
+// push `n` uninitialized items of type `t` onto arena `a`
+#define wrm_Arena_PUSH(a, t, n) ((t*)wrm_Arena_push((a), sizeof(t) * (n), _Alignof(t)))
+/*
+Initialize an arena that reserves `max_capacity` bytes of address space and
+commits the first `capacity` of them
+Containers can allocate from it through `a->allocator`, which must not outlive the arena
+Returns `true` if the operation was successful
 */
-void wrm_Stack_delete(wrm_Stack *p, wrm_FUNCTION(delete, void, void*));
+bool wrm_Arena_init(wrm_Arena *a, size_t capacity, size_t max_capacity);
+/*
+Push `size` uninitialized bytes aligned to `align` (a power of two) onto arena `a`,
+committing more pages if needed
+Returns NULL if the arena would exceed its maximum capacity
+*/
+void *wrm_Arena_push(wrm_Arena *a, size_t size, size_t align);
+/* Get a marker for the current top of arena `a` */
+inline wrm_Arena_Marker wrm_Arena_mark(wrm_Arena *a)
+{
+    return a->pos;
+}
+/* Roll back arena `a` to `marker`; everything pushed since it was made is now considered invalid */
+inline void wrm_Arena_restore(wrm_Arena *a, wrm_Arena_Marker marker)
+{
+    if(marker < a->pos) { a->pos = marker; }
+}
+/* Roll back arena `a` to empty, keeping its committed pages for reuse */
+inline void wrm_Arena_reset(wrm_Arena *a)
+{
+    a->pos = 0;
+}
+/* Release the address space of arena `a`; it is no longer usable after this point */
+void wrm_Arena_delete(wrm_Arena *a);
 
 
-// tree 
+// frame arena
 
-/* 
-Initializes a tree from a source buffer (from a pool/stack)
-Creates an auxiliary pool to hold the lists of each node's children
-`auto_reserve` determines whether the children pool can resize automatically to fit demand, and should be `true` unless memory is constrained
+/*
+Initialize both arenas of frame arena `fa`, as in `wrm_Arena_init()`
+Returns `true` if the operation was successful
+*/
+bool wrm_Frame_Arena_init(wrm_Frame_Arena *fa, size_t capacity, size_t max_capacity);
+/* Get the arena for the current frame */
+inline wrm_Arena *wrm_Frame_Arena_get(wrm_Frame_Arena *fa)
+{
+    return &fa->arenas[fa->curr];
+}
+/*
+End the current frame: the other arena is reset and becomes current
+Data pushed during the frame that just ended stays valid for one more frame
 */
-bool wrm_Tree_init(wrm_Tree *tree, wrm_Pool *src, size_t offset, size_t child_limit, bool auto_reserve);
+inline void wrm_Frame_Arena_swap(wrm_Frame_Arena *fa)
+{
+    fa->curr ^= 1;
+    fa->frame++;
+    wrm_Arena_reset(&fa->arenas[fa->curr]);
+}
+/* Release both arenas of frame arena `fa` */
+void wrm_Frame_Arena_delete(wrm_Frame_Arena *fa);
+
+
+// tree
+
+/*
+Initializes a tree over the elements of pool `src`, whose nodes live `offset` bytes into each element
+Needs no memory of its own; the links are kept valid if `src` is compacted
+*/
+bool wrm_Tree_init(wrm_Tree *tree, wrm_Pool *src, size_t offset);
+/*
+Initializes a flattened tree: like `wrm_Tree_init()`, but the nodes can also be laid out in pre-order with `wrm_Tree_flatten()`
+The flattened arrays get their memory from `allocator`, or the C heap if it is NULL
+*/
+bool wrm_Tree_initFlat(wrm_Tree *tree, wrm_Pool *src, size_t offset, const wrm_Allocator *allocator);
+/*
+Rebuild the flattened arrays of `tree` if the topology changed since the last call; does nothing if they are current
+Roots are laid out in slot order, children in the order they were added
+Fails if `tree` is not flattened, memory runs out or the links form a cycle
+*/
+bool wrm_Tree_flatten(wrm_Tree *tree);
+/*
+Mark the flattened arrays as out of date
+Links changed through the tree functions do this already; call it after getting or freeing slots of the source pool directly
+*/
+inline void wrm_Tree_invalidate(wrm_Tree *tree)
+{
+    if(tree) { tree->stale = true; }
+}
 /* simplified tree node accessor */
-inline wrm_Tree_Node *wrm_Tree_at(wrm_Tree *tree, wrm_Index idx)
+inline wrm_Tree_Node *wrm_Tree_at(wrm_Tree *tree, wrm_Handle idx)
 {
     if(!tree || !tree->src ) { return NULL; }
     return wrm_Pool_offsetAt(tree->src, idx, tree->offset);
 }
-/* Associates a child and parent, if possible */
+/* Same as `wrm_Tree_at()`, but read-only, so the element is not marked as written */
+inline const wrm_Tree_Node *wrm_Tree_peek(wrm_Tree *tree, wrm_Handle idx)
+{
+    const u8 *e = tree ? wrm_Pool_peek(tree->src, idx) : NULL;
+    return e ? (const wrm_Tree_Node*)(e + tree->offset) : NULL;
+}
+/*
+Iterate over the children of node `n` (a `wrm_Tree_Node*`) in the order they were added, binding each index to `c`
+The body must not unlink `c`; collect the children first if they are to be removed
+*/
+#define wrm_Tree_FOR_EACH_CHILD(tree, n, c) \
+    for(u32 c##_left = (n)->child_cnt, c = (n)->first_child; c##_left; c = --c##_left ? wrm_Tree_peek((tree), c)->next_sibling : c)
+/*
+Start walking the subtree under `root` in pre-order (`post` false) or post-order (`post` true)
+The path to the current node is pushed onto `arena`, so depth is bounded by the arena rather than the C stack;
+roll the arena back once the walk is done
+*/
+void wrm_Tree_Iter_init(wrm_Tree_Iter *it, wrm_Tree *tree, u32 root, bool post, wrm_Arena *arena);
+/*
+Get the next node of the walk, or none once it is over (check `overflow` to tell a full arena apart)
+The tree must not change during the walk
+*/
+wrm_Option_Handle wrm_Tree_Iter_next(wrm_Tree_Iter *it);
+/* Pre-order only: do not visit the children of the node returned last */
+inline void wrm_Tree_Iter_skipChildren(wrm_Tree_Iter *it)
+{
+    it->descend = false;
+}
+/*
+Visit the subtree under `root`: `enter()` is called on each node before its children and `leave()`, if not NULL, after them
+`enter()` returning false prunes the node's children; `leave()` is still called for the node itself
+`depth` is the number of ancestors between the node and `root`; the walk's path is pushed onto `arena`
+Returns false if the arena ran out of room
+*/
+bool wrm_Tree_visit(wrm_Tree *tree, u32 root, wrm_Arena *arena, wrm_FUNC(enter, bool, void *ctx, u32 node, u32 depth), wrm_FUNC(leave, void, void *ctx, u32 node, u32 depth), void *ctx);
+/*
+Associates a child and parent in O(1), appending the child to the parent's list, if possible
+Making a node a child of its own descendant is only refused with WRM_TREE_CHECK_CYCLES; otherwise
+the cycle has no root, so `wrm_Tree_flatten()` leaves its nodes out
+*/
 bool wrm_Tree_addChild(wrm_Tree *tree, u32 parent, u32 child);
-/* Dissociates a child and parent, if possible */
+/* Dissociates a child and parent in O(1), if possible */
 bool wrm_Tree_removeChild(wrm_Tree *tree, u32 parent, u32 child);
-/* Checks whether the parent has `child` in its child list */
+/* Checks whether `child` is a child of `parent` */
 bool wrm_Tree_hasChild(wrm_Tree *tree, u32 parent, u32 child);
 /* Makes a node a root in the tree: if it has a parent, orphan it */
 bool wrm_Tree_makeRoot(wrm_Tree *tree, u32 node);
-/* Dissociates all nodes and frees the lists of children */
+/* Cuts a node out of the tree before its slot is freed: it is orphaned and its children become roots */
+bool wrm_Tree_detach(wrm_Tree *tree, u32 node);
+/* Stops tracking the source pool and frees the flattened arrays; the nodes themselves are left as they are */
 void wrm_Tree_delete(wrm_Tree *tree);
+/*
+Copy the flattened arrays of tree `tree` into `snap`, which must be zeroed or
+hold an earlier snapshot; an earlier snapshot's memory is reused if it is big enough
+The links themselves live in the elements of the source pool, so snapshot and
+restore the pool alongside the tree
+Returns `true` if the operation was successful
+*/
+bool wrm_Tree_snapshot(wrm_Tree *tree, wrm_Tree_Snapshot *snap);
+/*
+Put the flattened arrays of tree `tree` back as saved in `snap`, so that
+restoring a pool and its tree does not need a new flatten
+Returns `true` if the operation was successful
+*/
+bool wrm_Tree_restore(wrm_Tree *tree, const wrm_Tree_Snapshot *snap);
+/* Release the memory of tree snapshot `snap` */
+void wrm_Tree_Snapshot_delete(wrm_Tree_Snapshot *snap);
 /* print the contents of the tree node */
 void wrm_Tree_debugNode(wrm_Tree_Node *tn, wrm_Tree *tree);
 
 
+// map
+
+/*
+Initialize a map with room for `capacity` entries of `key_size`-byte keys and `value_size`-byte values
+`hash()` and `equals()` work on the bytes of a key; NULL means `wrm_Map_hashBytes()` and a byte comparison
+Memory comes from `allocator`, or the C heap if it is NULL; an arena's allocator works well for maps that live until a rollback
+Returns `true` if the operation was successful
+*/
+bool wrm_Map_init(wrm_Map *m, size_t capacity, size_t key_size, size_t value_size, wrm_FUNC(hash, u64, const void *key, size_t size), wrm_FUNC(equals, bool, const void *a, const void *b, size_t size), const wrm_Allocator *allocator);
+/* Hash the `size` bytes at `key` */
+u64 wrm_Map_hashBytes(const void *key, size_t size);
+/* Hash and compare keys that are `const char*`, by the strings they point to */
+u64 wrm_Map_hashStr(const void *key, size_t size);
+bool wrm_Map_equalsStr(const void *a, const void *b, size_t size);
+/* Get a pointer to the value stored under `key` in map `m`, or NULL if there is none */
+void *wrm_Map_get(wrm_Map *m, const void *key);
+/*
+Store `value` under `key` in map `m`, replacing any value already there; a NULL `value` leaves a new value zeroed
+Returns a pointer to the stored value, valid until the next put, or NULL if the map could not grow
+*/
+void *wrm_Map_put(wrm_Map *m, const void *key, const void *value);
+/* Remove `key` and its value from map `m`; returns `false` if it was not there */
+bool wrm_Map_remove(wrm_Map *m, const void *key);
+/* Make room for `capacity` entries in map `m`, so that many can be put without growing */
+bool wrm_Map_reserve(wrm_Map *m, size_t capacity);
+/* Remove every entry from map `m`, keeping its memory */
+void wrm_Map_clear(wrm_Map *m);
+/* Get the first taken slot of map `m` at or after `slot`, or `m->cap` if there is none */
+inline size_t wrm_Map_next(wrm_Map *m, size_t slot)
+{
+    while(slot < m->cap && (m->ctrl[slot] & WRM_MAP_EMPTY)) { slot++; }
+    return slot;
+}
+/* Iterate over the taken slots of map `m`, binding each to `i`; the map must not be changed meanwhile */
+#define wrm_Map_FOR_EACH(m, i) \
+    for(size_t i = wrm_Map_next((m), 0); i < (m)->cap; i = wrm_Map_next((m), i + 1))
+/* Get the key in taken slot `slot` of map `m` */
+inline void *wrm_Map_keyAt(wrm_Map *m, size_t slot)
+{
+    return m->keys + slot * m->key_size;
+}
+/* Get the value in taken slot `slot` of map `m` */
+inline void *wrm_Map_valueAt(wrm_Map *m, size_t slot)
+{
+    return m->values + slot * m->value_size;
+}
+/* Release the memory of map `m`; it is no longer usable afterwards */
+void wrm_Map_delete(wrm_Map *m);
+
+
+// sort
+
+/*
+Sort `n` key/index pairs in `keys` by ascending key, keeping pairs with equal
+keys in their order, with one pass per `WRM_SORT_RADIX_BITS` bits of the key
+Passes over bits that every key shares are skipped, so keys that only use
+part of their 64 bits cost less
+`tmp` must have room for `n` pairs; its contents are left undefined
+*/
+void wrm_radixSort(wrm_Sort_Key *keys, wrm_Sort_Key *tmp, size_t n);
+
+
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,11 @@
+// file: default-color-instanced.frag
+#version 330 core
+
+in vec4 col;
+
+out vec4 f_col;
+
+void main()
+{
+    f_col = col;
+}
\ No newline at end of file
@@ -0,0 +1,21 @@
+// file: default-color-instanced.vert
+#version 330 core
+
+layout (location = 0) in vec3 v_pos; // positions are location 0
+layout (location = 1) in vec4 v_col; // colors are location 1
+layout (location = 4) in mat4 i_model; // per-instance model matrix, locations 4-7
+
+// per-frame camera matrices, shared by every shader through one uniform buffer
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 proj;
+    mat4 view_proj;
+};
+
+out vec4 col; // specify a color output to the fragment shader
+
+void main()
+{
+    gl_Position = view_proj * i_model * vec4(v_pos, 1.0);
+    col = v_col;
+}
\ No newline at end of file
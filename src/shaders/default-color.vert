@@ -4,12 +4,19 @@
 layout (location = 0) in vec3 v_pos; // positions are location 0
 layout (location = 1) in vec4 v_col; // colors are location 1
 
-uniform mat4 mvp;
+// per-frame camera matrices, shared by every shader through one uniform buffer
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 proj;
+    mat4 view_proj;
+};
+
+uniform mat4 model;
 
 out vec4 col; // specify a color output to the fragment shader
 
 void main()
 {
-    gl_Position = mvp * vec4(v_pos, 1.0);
+    gl_Position = view_proj * model * vec4(v_pos, 1.0);
     col = v_col;
 }
\ No newline at end of file
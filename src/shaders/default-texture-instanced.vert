@@ -0,0 +1,21 @@
+// file: default-texture-instanced.vert
+#version 330 core 
+
+layout (location = 0) in vec3 v_pos; // positions are location 0
+layout (location = 2) in vec2 v_uv; // uvs are location 2
+layout (location = 4) in mat4 i_model; // per-instance model matrix, locations 4-7
+
+// per-frame camera matrices, shared by every shader through one uniform buffer
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 proj;
+    mat4 view_proj;
+};
+
+out vec2 uv; // specify a uv for the fragment shader
+
+void main()
+{
+    gl_Position = view_proj * i_model * vec4(v_pos, 1.0);
+    uv = v_uv;
+}
\ No newline at end of file
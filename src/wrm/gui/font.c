@@ -22,7 +22,7 @@ wrm_Option_Handle wrm_gui_loadFont(const char *path)
 
     if(!f) { return OPTION_NONE(Handle); }
 
-    f->glyphs = calloc(WRM_FONT_GLYPHS_COUNT, sizeof(wrm_Glyph));
+    f->glyphs = wrm_alloc(wrm_gui_allocator, WRM_FONT_GLYPHS_COUNT * sizeof(wrm_Glyph));
 
     // use freetype
 
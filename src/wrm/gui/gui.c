@@ -4,9 +4,12 @@ FT_Library wrm_ft_library;
 wrm_Stack wrm_fonts;
 
 wrm_Pool wrm_gui_elements;
-wrm_Stack wrm_gui_tbd; // elements to be drawn
+wrm_Handle *wrm_gui_tbd; // elements to be drawn, pushed to the render frame arena
+size_t wrm_gui_tbd_len;
 wrm_Tree wrm_gui_tree;
 
+const wrm_Allocator *wrm_gui_allocator;
+
 
 static const char *WRM_GUI_TEXT_SHADER_NAME = "ui-text";
 static const char *WRM_GUI_IMAGE_SHADER_NAME = "ui-image";
@@ -16,40 +19,38 @@ wrm_Handle wrm_gui_text_shader;
 wrm_Handle wrm_gui_image_shader;
 wrm_Handle wrm_gui_pane_shader;
 
-// wrm_Pool wrm_gui_child_lists;
 
 // file-internal helper declarations
 static void wrm_gui_prepareElements(void);
 static bool wrm_gui_createDefaultShaders(const char *shader_dir);
-static void wrm_gui_addElementAndChildren(wrm_Handle element);
+static void wrm_gui_addElementAndChildren(wrm_Handle element, wrm_Arena *arena);
 
 // user-visible
 
-bool wrm_gui_init(const char *shader_dir)
+bool wrm_gui_init(const char *shader_dir, const wrm_Allocator *allocator)
 {
-    
+    wrm_gui_allocator = allocator;
+
     if(FT_Init_FreeType(&wrm_ft_library)) {
         wrm_error("GUI", "init()", "failed to initialize FreeType");
         return false;
     }
 
-    if(!wrm_Stack_init(&wrm_fonts, WRM_GUI_INITIAL_ELEMENTS_CAPACITY, sizeof(wrm_Font), true)) {
+    if(!wrm_Stack_init(&wrm_fonts, WRM_GUI_INITIAL_ELEMENTS_CAPACITY, sizeof(wrm_Font), true, wrm_gui_allocator)) {
         wrm_error("GUI", "init()", "failed to initialize fonts list");
         return false;
     }
     
-    if(!wrm_Pool_init(&wrm_gui_elements, WRM_GUI_INITIAL_ELEMENTS_CAPACITY, sizeof(wrm_gui_Element), true)) {
+    if(!wrm_Pool_initDense(&wrm_gui_elements, WRM_GUI_INITIAL_ELEMENTS_CAPACITY, sizeof(wrm_gui_Element), true, wrm_gui_allocator)) {
         wrm_error("GUI", "init()", "failed to initialize elements pool");
         return false;
     }
-    if(!wrm_Stack_init(&wrm_gui_tbd, WRM_GUI_INITIAL_ELEMENTS_CAPACITY, sizeof(wrm_Handle), true)) {
-        wrm_error("GUI", "init()", "failed to initialize draw list");
-        return false;
-    }
-    if(!wrm_Tree_init(&wrm_gui_tree, &wrm_gui_elements, offsetof(wrm_gui_Element, properties.tree_node), WRM_MODEL_CHILD_LIMIT, true)) {
+    if(!wrm_Tree_init(&wrm_gui_tree, &wrm_gui_elements, offsetof(wrm_gui_Element, properties.tree_node))) {
         wrm_error("GUI", "init()", "failed to initialize gui tree");
         return false;
     }
+    wrm_memoryTrack("wrm_gui_elements", WRM_MEMORY_POOL, &wrm_gui_elements);
+    wrm_memoryTrack("wrm_fonts", WRM_MEMORY_STACK, &wrm_fonts);
 
 
     wrm_gui_initQuad();
@@ -78,13 +79,13 @@ void wrm_gui_draw(void)
     wrm_gui_prepareElements();
 
     if(wrm_render_debug_frame) {
-        printf("\nGUI (2D) PASS (%zu element%s to be drawn):\n", wrm_gui_tbd.len, wrm_gui_tbd.len == 1 ? "" : "s");
+        printf("\nGUI (2D) PASS (%zu element%s to be drawn):\n", wrm_gui_tbd_len, wrm_gui_tbd_len == 1 ? "" : "s");
     }
 
-    for(u32 i = 0; i < wrm_gui_tbd.len; i++) {
-        wrm_Handle *idx = wrm_Stack_at(&wrm_gui_tbd, i);
-        if(!idx) continue; // skip this one, I guess? this shouldn't really happen
-        wrm_gui_Element *e = wrm_Pool_at(&wrm_gui_elements, *idx);
+    for(u32 i = 0; i < wrm_gui_tbd_len; i++) {
+        // the draw list was built from live elements this frame
+        wrm_Handle *idx = wrm_gui_tbd + i;
+        wrm_gui_Element *e = wrm_Pool_slotData(&wrm_gui_elements, *idx);
 
         if(wrm_render_debug_frame) {
             wrm_gui_debugElement(*idx);
@@ -111,7 +112,12 @@ void wrm_gui_draw(void)
 
 void wrm_gui_quit(void)
 {
+    // fonts stay loaded for the program's lifetime, so only elements can leak
+    wrm_memoryReportLeaks(&wrm_gui_elements);
 
+    wrm_Tree_delete(&wrm_gui_tree);
+    wrm_Pool_delete(&wrm_gui_elements, NULL);
+    wrm_Stack_delete(&wrm_fonts, NULL);
 }
 
 void wrm_gui_debugElement(wrm_Handle element)
@@ -200,41 +206,39 @@ static bool wrm_gui_createDefaultShaders(const char *shader_dir)
 
 static void wrm_gui_prepareElements(void)
 {
-    wrm_Stack_reset(&wrm_gui_tbd, 0);
+    // each element is drawn at most once, so the list needs at most one entry per element
+    wrm_gui_tbd_len = 0;
+    wrm_gui_tbd = wrm_Arena_PUSH(wrm_Frame_Arena_get(&wrm_render_frame), wrm_Handle, wrm_gui_elements.used_cnt);
+    if(!wrm_gui_tbd) {
+        wrm_error("GUI", "prepareElements()", "failed to allocate space for the draw list");
+        return;
+    }
 
-    for(u32 i = 0; i < wrm_gui_elements.cap; i++) {
-        wrm_gui_Element *e = wrm_Pool_at(&wrm_gui_elements, i);
+    // elements are packed, so roots can be found with a linear walk
+    for(u32 pos = 0; pos < wrm_gui_elements.used_cnt; pos++) {
+        wrm_gui_Element *e = wrm_Pool_packedAt(&wrm_gui_elements, pos);
 
-        if(e && !e->properties.tree_node.has_parent) {
-            wrm_gui_addElementAndChildren(i);
+        if(!e->properties.tree_node.has_parent) {
+            wrm_gui_addElementAndChildren(wrm_gui_elements.slot_of[pos], wrm_Frame_Arena_get(&wrm_render_frame));
         }
     }
 }
 
-static void wrm_gui_addElementAndChildren(wrm_Handle element) 
+static void wrm_gui_addElementAndChildren(wrm_Handle element, wrm_Arena *arena) 
 {
-    wrm_gui_Element *e = wrm_Pool_at(&wrm_gui_elements, element);
-    if(!e) return;
-    wrm_gui_Properties *p = &e->properties;
-
-    // then add the element, if visible
-    wrm_Option_Handle top = wrm_Stack_push(&wrm_gui_tbd);
-    if(!top.exists) {
-        wrm_error("GUI", "addElementAndChildren()", "failed to allocate space on draw stack");
-        return;
-    }
-    wrm_data_AS(wrm_gui_tbd, wrm_Handle)[top.val] = element;
+    // walk the subtree in pre-order, keeping the path in the frame arena
+    wrm_Arena_Marker marker = wrm_Arena_mark(arena);
+    wrm_Tree_Iter it;
+    wrm_Tree_Iter_init(&it, &wrm_gui_tree, element, false, arena);
 
-    // then add the element's children, if there are any and they are visible
-    if(!(p->tree_node.child_cnt && p->children_shown)) { return; }
+    for(wrm_Option_Handle next = wrm_Tree_Iter_next(&it); next.exists; next = wrm_Tree_Iter_next(&it)) {
+        wrm_gui_Element *e = wrm_Pool_at(&wrm_gui_elements, next.val);
 
-    if(p->tree_node.child_cnt == 1) {
-        wrm_gui_addElementAndChildren(p->tree_node.children);
-    }
-    else {
-        u32 *children = wrm_Pool_at(&wrm_gui_tree.child_lists, p->tree_node.children);
-        for(u8 i = 0; i < p->tree_node.child_cnt; i++) {
-            wrm_gui_addElementAndChildren(children[i]);
-        }
+        // add the element, then its children if they are visible
+        wrm_gui_tbd[wrm_gui_tbd_len++] = next.val;
+        if(!e->properties.children_shown) { wrm_Tree_Iter_skipChildren(&it); }
     }
+    if(it.overflow) { wrm_error("GUI", "addElementAndChildren()", "ran out of space for the element tree path"); }
+
+    wrm_Arena_restore(arena, marker);
 }
\ No newline at end of file
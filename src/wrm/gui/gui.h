@@ -78,13 +78,14 @@ extern wrm_Stack wrm_fonts;
 
 extern wrm_Pool wrm_gui_elements;
 extern wrm_Tree wrm_gui_tree;
+
+extern const wrm_Allocator *wrm_gui_allocator;
 extern wrm_Quad the_quad;
 
 extern wrm_Handle wrm_gui_text_shader;
 extern wrm_Handle wrm_gui_image_shader;
 extern wrm_Handle wrm_gui_pane_shader;
 
-// extern wrm_Pool wrm_gui_child_lists; unused for now
 
 /*
 Module internal functions
@@ -41,7 +41,7 @@ void wrm_gui_drawText(wrm_Text *t)
     wrm_render_setGLShader(wrm_gui_text_shader);
 
     wrm_Shader *s = wrm_Pool_at(&wrm_shaders, wrm_gui_text_shader);
-    GLint color_loc = glGetUniformLocation(s->program, "text_col");
+    GLint color_loc = wrm_render_uniform(s, WRM_SHADER_UNIFORM_TEXT_COL);
     if(color_loc != -1) {
         wrm_RGBAf color = wrm_RGBAf_fromRGBA(t->text_color);
         glUniform3fv(color_loc, 1, (float[]){color.r, color.g, color.b});
@@ -33,15 +33,17 @@ static int wrm_window_height;
 static wrm_List_Key wrm_keys;
 static wrm_Mouse wrm_mouse;
 static wrm_Settings wrm_input_settings;
+static const wrm_Allocator *wrm_input_allocator;
 
 
 /*
 Module function definitions
 */
 
-bool wrm_input_init(wrm_Settings *s, SDL_Window *w)
+bool wrm_input_init(wrm_Settings *s, SDL_Window *w, const wrm_Allocator *allocator)
 {
     wrm_input_settings = *s;
+    wrm_input_allocator = allocator;
     wrm_input_should_quit = false;
     wrm_window = w;
 
@@ -56,7 +58,7 @@ bool wrm_input_init(wrm_Settings *s, SDL_Window *w)
     }
 
     wrm_keys.cap = (u32)num_keys;
-    wrm_keys.data = malloc(wrm_keys.cap * sizeof(wrm_Key));
+    wrm_keys.data = wrm_alloc(wrm_input_allocator, wrm_keys.cap * sizeof(wrm_Key));
 
     if(!wrm_keys.data) {
         if(wrm_input_settings.errors) { fprintf(stderr, "ERROR: Input: init(): unable to allocate keyboard data buffer\n"); }
@@ -151,7 +153,7 @@ void wrm_input_setMouseState(bool relative)
 
 void wrm_input_quit(void)
 {
-    free(wrm_keys.data);
+    wrm_free(wrm_input_allocator, wrm_keys.data, wrm_keys.cap * sizeof(wrm_Key));
 }
 
 
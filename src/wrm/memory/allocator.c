@@ -0,0 +1,105 @@
+#include "wrm/memory.h"
+
+// file-internal helper declarations
+static void *wrm_heap_alloc(void *ctx, size_t size);
+static void *wrm_heap_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size);
+static void wrm_heap_free(void *ctx, void *ptr, size_t size);
+static void *wrm_Tracking_Allocator_alloc(void *ctx, size_t size);
+static void *wrm_Tracking_Allocator_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size);
+static void wrm_Tracking_Allocator_free(void *ctx, void *ptr, size_t size);
+
+const wrm_Allocator wrm_heap_allocator = {
+    .alloc = wrm_heap_alloc,
+    .realloc = wrm_heap_realloc,
+    .free = wrm_heap_free,
+    .ctx = NULL
+};
+
+void wrm_Tracking_Allocator_init(wrm_Tracking_Allocator *t, const char *name, const wrm_Allocator *parent)
+{
+    if(!t) { return; }
+
+    *t = (wrm_Tracking_Allocator) {
+        .allocator = {
+            .alloc = wrm_Tracking_Allocator_alloc,
+            .realloc = wrm_Tracking_Allocator_realloc,
+            .free = wrm_Tracking_Allocator_free,
+            .ctx = t
+        },
+        .parent = parent,
+        .name = name
+    };
+}
+
+void wrm_Tracking_Allocator_print(const wrm_Tracking_Allocator *t)
+{
+    if(!t) { return; }
+
+    printf(
+        "%s: %zu bytes in use (peak %zu), %zu allocs, %zu reallocs, %zu frees\n",
+        t->name ? t->name : "(unnamed)", t->bytes, t->peak, t->alloc_cnt, t->realloc_cnt, t->free_cnt
+    );
+}
+
+// file-internal helpers
+
+static void *wrm_heap_alloc(void *ctx, size_t size)
+{
+    (void)ctx;
+    return calloc(1, size);
+}
+
+static void *wrm_heap_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size)
+{
+    (void)ctx;
+    (void)old_size;
+    return realloc(ptr, new_size);
+}
+
+static void wrm_heap_free(void *ctx, void *ptr, size_t size)
+{
+    (void)ctx;
+    (void)size;
+    free(ptr);
+}
+
+static void *wrm_Tracking_Allocator_alloc(void *ctx, size_t size)
+{
+    wrm_Tracking_Allocator *t = ctx;
+
+    void *ptr = wrm_alloc(t->parent, size);
+    if(!ptr) { return NULL; }
+
+    t->alloc_cnt++;
+    t->bytes += size;
+    if(t->bytes > t->peak) { t->peak = t->bytes; }
+    return ptr;
+}
+
+static void *wrm_Tracking_Allocator_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size)
+{
+    wrm_Tracking_Allocator *t = ctx;
+
+    void *new_ptr = wrm_realloc(t->parent, ptr, old_size, new_size);
+    if(!new_ptr) { return NULL; }
+
+    t->realloc_cnt++;
+    t->bytes = t->bytes - old_size + new_size;
+    if(t->bytes > t->peak) { t->peak = t->bytes; }
+    return new_ptr;
+}
+
+static void wrm_Tracking_Allocator_free(void *ctx, void *ptr, size_t size)
+{
+    wrm_Tracking_Allocator *t = ctx;
+
+    wrm_free(t->parent, ptr, size);
+    t->free_cnt++;
+    t->bytes -= size;
+}
+
+// force the compiler to emit a symbol
+
+void *wrm_alloc(const wrm_Allocator *a, size_t size);
+void *wrm_realloc(const wrm_Allocator *a, void *ptr, size_t old_size, size_t new_size);
+void wrm_free(const wrm_Allocator *a, void *ptr, size_t size);
@@ -0,0 +1,126 @@
+#include "wrm/memory.h"
+
+// alignment of allocations made through an arena's `allocator`
+#define WRM_ARENA_ALLOC_ALIGN 16
+
+// file-internal helper declarations
+static void *wrm_Arena_alloc(void *ctx, size_t size);
+static void *wrm_Arena_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size);
+static void wrm_Arena_free(void *ctx, void *ptr, size_t size);
+
+bool wrm_Arena_init(wrm_Arena *a, size_t capacity, size_t max_capacity)
+{
+    if(!a || capacity > max_capacity) return false;
+
+    a->allocator = (wrm_Allocator){
+        .alloc = wrm_Arena_alloc,
+        .realloc = wrm_Arena_realloc,
+        .free = wrm_Arena_free,
+        .ctx = a
+    };
+    a->data = wrm_virtualReserve(max_capacity);
+    a->pos = 0;
+    a->cap = capacity;
+    a->max_cap = max_capacity;
+
+    a->peak = 0;
+    a->push_cnt = 0;
+    a->commit_cnt = 0;
+
+    return wrm_virtualCommit(a->data, capacity);
+}
+
+void *wrm_Arena_push(wrm_Arena *a, size_t size, size_t align)
+{
+    size_t start = (a->pos + align - 1) & ~(align - 1);
+    size_t end = start + size;
+
+    if(end > a->cap) { // commit more pages, at least doubling the committed size
+        if(end > a->max_cap) { return NULL; }
+
+        size_t new_cap = a->cap * WRM_MEMORY_GROWTH_FACTOR;
+        if(new_cap < end) { new_cap = end; }
+        if(new_cap > a->max_cap) { new_cap = a->max_cap; }
+        if(!wrm_virtualCommit(a->data, new_cap)) { return NULL; }
+
+        a->cap = new_cap;
+        a->commit_cnt++;
+    }
+
+    a->pos = end;
+    if(end > a->peak) { a->peak = end; }
+    a->push_cnt++;
+    return a->data + start;
+}
+
+void wrm_Arena_delete(wrm_Arena *a)
+{
+    if(!a || !a->data) { return; }
+
+    wrm_memoryUntrack(a);
+    wrm_virtualRelease(a->data, a->max_cap);
+    a->data = NULL;
+    a->pos = 0;
+    a->cap = 0;
+    a->max_cap = 0;
+}
+
+bool wrm_Frame_Arena_init(wrm_Frame_Arena *fa, size_t capacity, size_t max_capacity)
+{
+    if(!fa) return false;
+
+    fa->curr = 0;
+    fa->frame = 0;
+    return wrm_Arena_init(&fa->arenas[0], capacity, max_capacity) && wrm_Arena_init(&fa->arenas[1], capacity, max_capacity);
+}
+
+void wrm_Frame_Arena_delete(wrm_Frame_Arena *fa)
+{
+    if(!fa) { return; }
+
+    wrm_memoryUntrack(fa);
+    wrm_Arena_delete(&fa->arenas[0]);
+    wrm_Arena_delete(&fa->arenas[1]);
+}
+
+// file-internal helpers
+
+static void *wrm_Arena_alloc(void *ctx, size_t size)
+{
+    // memory reused after a rollback still holds old contents
+    void *ptr = wrm_Arena_push(ctx, size, WRM_ARENA_ALLOC_ALIGN);
+    if(ptr) { memset(ptr, 0, size); }
+    return ptr;
+}
+
+static void *wrm_Arena_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size)
+{
+    wrm_Arena *a = ctx;
+    if(!ptr) { return wrm_Arena_push(a, new_size, WRM_ARENA_ALLOC_ALIGN); }
+
+    // the most recent allocation can grow or shrink in place
+    if((u8*)ptr + old_size == a->data + a->pos) {
+        size_t start = (size_t)((u8*)ptr - a->data);
+        if(start + new_size > a->pos && !wrm_Arena_push(a, start + new_size - a->pos, 1)) { return NULL; }
+        a->pos = start + new_size;
+        return ptr;
+    }
+
+    void *moved = wrm_Arena_push(a, new_size, WRM_ARENA_ALLOC_ALIGN);
+    if(moved) { memcpy(moved, ptr, old_size < new_size ? old_size : new_size); }
+    return moved;
+}
+
+static void wrm_Arena_free(void *ctx, void *ptr, size_t size)
+{
+    wrm_Arena *a = ctx;
+    if((u8*)ptr + size == a->data + a->pos) { a->pos -= size; }
+}
+
+// force the compiler to emit a symbol
+
+wrm_Arena_Marker wrm_Arena_mark(wrm_Arena *a);
+void wrm_Arena_restore(wrm_Arena *a, wrm_Arena_Marker marker);
+void wrm_Arena_reset(wrm_Arena *a);
+wrm_Arena *wrm_Frame_Arena_get(wrm_Frame_Arena *fa);
+void wrm_Frame_Arena_swap(wrm_Frame_Arena *fa);
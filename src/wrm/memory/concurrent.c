@@ -0,0 +1,112 @@
+#include "wrm/memory.h"
+
+// file-internal helper declarations
+static u32 wrm_Concurrent_Pool_popFree(wrm_Concurrent_Pool *p);
+static void wrm_Concurrent_Pool_pushFree(wrm_Concurrent_Pool *p, u32 idx);
+
+bool wrm_Concurrent_Pool_init(wrm_Concurrent_Pool *p, size_t capacity, size_t element_size, const wrm_Allocator *allocator)
+{
+    if(!p || capacity >= WRM_POOL_NO_SLOT) return false;
+
+    p->e_size = element_size;
+    p->cap = capacity;
+    p->allocator = allocator;
+
+    p->data = wrm_alloc(allocator, capacity * element_size);
+    p->next_free = wrm_alloc(allocator, capacity * sizeof(_Atomic u32));
+    p->gens = wrm_alloc(allocator, capacity * sizeof(_Atomic u32));
+
+    atomic_init(&p->free_head, (u64)WRM_POOL_NO_SLOT);
+    atomic_init(&p->top, 0);
+    atomic_init(&p->used_cnt, 0);
+
+    return p->data && p->next_free && p->gens;
+}
+
+wrm_Option_Ref wrm_Concurrent_Pool_getSlot(wrm_Concurrent_Pool *p)
+{
+    u32 i = wrm_Concurrent_Pool_popFree(p);
+
+    if(i == WRM_POOL_NO_SLOT) { // take a never-used slot
+        u32 top = atomic_load_explicit(&p->top, memory_order_relaxed);
+        do {
+            if(top == p->cap) { return OPTION_NONE(Ref); }
+        } while(!atomic_compare_exchange_weak_explicit(&p->top, &top, top + 1, memory_order_relaxed, memory_order_relaxed));
+        i = top;
+    }
+
+    // the slot belongs to this thread alone until the generation is published
+    memset((u8*)p->data + i * p->e_size, 0, p->e_size);
+    u32 gen = atomic_fetch_add_explicit(&p->gens[i], 1, memory_order_release) + 1;
+    atomic_fetch_add_explicit(&p->used_cnt, 1, memory_order_relaxed);
+
+    return OPTION_SOME(Ref, ((wrm_Ref){ .src = WRM_POOL_NO_ID, .idx = i, .gen = gen }));
+}
+
+bool wrm_Concurrent_Pool_freeSlot(wrm_Concurrent_Pool *p, wrm_Ref ref)
+{
+    if(ref.idx >= p->cap || !(ref.gen & 1)) { return false; }
+
+    // claim the free: only one thread can move the generation on from `ref.gen`
+    u32 expected = ref.gen;
+    if(!atomic_compare_exchange_strong_explicit(&p->gens[ref.idx], &expected, ref.gen + 1, memory_order_acq_rel, memory_order_relaxed)) {
+        return false;
+    }
+
+    atomic_fetch_sub_explicit(&p->used_cnt, 1, memory_order_relaxed);
+    wrm_Concurrent_Pool_pushFree(p, ref.idx);
+    return true;
+}
+
+void wrm_Concurrent_Pool_delete(wrm_Concurrent_Pool *p)
+{
+    if(!p || !p->data) { return; }
+
+    wrm_free(p->allocator, p->data, p->cap * p->e_size);
+    wrm_free(p->allocator, p->next_free, p->cap * sizeof(_Atomic u32));
+    wrm_free(p->allocator, p->gens, p->cap * sizeof(_Atomic u32));
+
+    p->data = NULL;
+    p->next_free = NULL;
+    p->gens = NULL;
+    p->cap = 0;
+}
+
+// file-internal helpers
+
+/*
+Pop the top of the free list, or return `WRM_POOL_NO_SLOT` if it is empty
+The tag in the head's high bits changes on every push and pop, so a head that
+was popped and pushed back between our load and our swap (ABA) fails the swap
+*/
+static u32 wrm_Concurrent_Pool_popFree(wrm_Concurrent_Pool *p)
+{
+    u64 head = atomic_load_explicit(&p->free_head, memory_order_acquire);
+    u64 new_head;
+    u32 idx;
+
+    do {
+        idx = (u32)head;
+        if(idx == WRM_POOL_NO_SLOT) { return WRM_POOL_NO_SLOT; }
+
+        u32 next = atomic_load_explicit(&p->next_free[idx], memory_order_relaxed);
+        new_head = ((head >> 32) + 1) << 32 | next;
+    } while(!atomic_compare_exchange_weak_explicit(&p->free_head, &head, new_head, memory_order_acquire, memory_order_acquire));
+
+    return idx;
+}
+
+static void wrm_Concurrent_Pool_pushFree(wrm_Concurrent_Pool *p, u32 idx)
+{
+    u64 head = atomic_load_explicit(&p->free_head, memory_order_relaxed);
+    u64 new_head;
+
+    do {
+        atomic_store_explicit(&p->next_free[idx], (u32)head, memory_order_relaxed);
+        new_head = ((head >> 32) + 1) << 32 | idx;
+    } while(!atomic_compare_exchange_weak_explicit(&p->free_head, &head, new_head, memory_order_release, memory_order_relaxed));
+}
+
+// force the compiler to emit a symbol
+
+void *wrm_Concurrent_Pool_deref(wrm_Concurrent_Pool *p, wrm_Ref ref);
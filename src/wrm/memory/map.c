@@ -0,0 +1,279 @@
+#include "wrm/memory.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// slot search result when the key is not in the map
+#define WRM_MAP_NOT_FOUND SIZE_MAX
+// the map grows (or is cleaned of deleted slots) once it is this full, in eighths
+#define WRM_MAP_MAX_LOAD 7
+
+// file-internal helper declarations
+static bool wrm_Map_equalsBytes(const void *a, const void *b, size_t size);
+static u32 wrm_Map_match(const u8 *group, u8 byte);
+static u32 wrm_Map_matchFree(const u8 *group);
+static size_t wrm_Map_find(wrm_Map *m, const void *key, u64 hash, size_t *free_slot);
+static bool wrm_Map_rehash(wrm_Map *m, size_t capacity);
+static size_t wrm_Map_blockSize(wrm_Map *m, size_t capacity, size_t *keys_at, size_t *values_at);
+
+bool wrm_Map_init(wrm_Map *m, size_t capacity, size_t key_size, size_t value_size, wrm_FUNC(hash, u64, const void *key, size_t size), wrm_FUNC(equals, bool, const void *a, const void *b, size_t size), const wrm_Allocator *allocator)
+{
+    if(!m || !key_size) { return false; }
+
+    *m = (wrm_Map){
+        .key_size = key_size,
+        .value_size = value_size,
+        .hash = hash ? hash : wrm_Map_hashBytes,
+        .equals = equals ? equals : wrm_Map_equalsBytes,
+        .allocator = allocator
+    };
+    return wrm_Map_reserve(m, capacity);
+}
+
+u64 wrm_Map_hashBytes(const void *key, size_t size)
+{
+    const u8 *bytes = key;
+    u64 h = 0x9e3779b97f4a7c15ull ^ size;
+
+    // mix in a word at a time, then the leftover bytes
+    while(size >= 8) {
+        u64 word;
+        memcpy(&word, bytes, 8);
+        h = (h ^ word) * 0xff51afd7ed558ccdull;
+        h ^= h >> 32;
+        bytes += 8;
+        size -= 8;
+    }
+    if(size) {
+        u64 word = 0;
+        memcpy(&word, bytes, size);
+        h = (h ^ word) * 0xff51afd7ed558ccdull;
+        h ^= h >> 32;
+    }
+
+    // finalize so that both the low bits (control byte) and high bits (group) are well spread
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+u64 wrm_Map_hashStr(const void *key, size_t size)
+{
+    (void)size;
+    const char *str = *(const char**)key;
+    return wrm_Map_hashBytes(str, strlen(str));
+}
+
+bool wrm_Map_equalsStr(const void *a, const void *b, size_t size)
+{
+    (void)size;
+    return strcmp(*(const char**)a, *(const char**)b) == 0;
+}
+
+void *wrm_Map_get(wrm_Map *m, const void *key)
+{
+    if(!m || !key || !m->len) { return NULL; }
+
+    size_t slot = wrm_Map_find(m, key, m->hash(key, m->key_size), NULL);
+    return slot == WRM_MAP_NOT_FOUND ? NULL : wrm_Map_valueAt(m, slot);
+}
+
+void *wrm_Map_put(wrm_Map *m, const void *key, const void *value)
+{
+    if(!m || !key) { return NULL; }
+
+    u64 hash = m->hash(key, m->key_size);
+    size_t free_slot;
+    size_t slot = wrm_Map_find(m, key, hash, &free_slot);
+
+    if(slot == WRM_MAP_NOT_FOUND) {
+        // grow if full; if most of the load is deleted slots, clean them out at the same size instead
+        if((m->len + m->deleted_cnt + 1) * 8 > m->cap * WRM_MAP_MAX_LOAD) {
+            size_t new_cap = (m->len + 1) * 16 > m->cap * WRM_MAP_MAX_LOAD ? m->cap * WRM_MEMORY_GROWTH_FACTOR : m->cap;
+            if(!wrm_Map_rehash(m, new_cap)) { return NULL; }
+            wrm_Map_find(m, key, hash, &free_slot);
+        }
+
+        slot = free_slot;
+        if(m->ctrl[slot] == WRM_MAP_DELETED) { m->deleted_cnt--; }
+        m->ctrl[slot] = (u8)(hash & 0x7f);
+        m->len++;
+        memcpy(wrm_Map_keyAt(m, slot), key, m->key_size);
+        if(!value) { memset(wrm_Map_valueAt(m, slot), 0, m->value_size); }
+    }
+
+    if(value) { memcpy(wrm_Map_valueAt(m, slot), value, m->value_size); }
+    return wrm_Map_valueAt(m, slot);
+}
+
+bool wrm_Map_remove(wrm_Map *m, const void *key)
+{
+    if(!m || !key || !m->len) { return false; }
+
+    size_t slot = wrm_Map_find(m, key, m->hash(key, m->key_size), NULL);
+    if(slot == WRM_MAP_NOT_FOUND) { return false; }
+
+    // a slot in a group with an empty slot can never have been probed past, so it can become empty again
+    const u8 *group = m->ctrl + (slot & ~(size_t)(WRM_MAP_GROUP_SIZE - 1));
+    if(wrm_Map_match(group, WRM_MAP_EMPTY)) {
+        m->ctrl[slot] = WRM_MAP_EMPTY;
+    }
+    else {
+        m->ctrl[slot] = WRM_MAP_DELETED;
+        m->deleted_cnt++;
+    }
+    m->len--;
+    return true;
+}
+
+bool wrm_Map_reserve(wrm_Map *m, size_t capacity)
+{
+    if(!m) { return false; }
+
+    // keep the load under the maximum once `capacity` entries are in
+    size_t cap = WRM_MAP_GROUP_SIZE;
+    while(cap * WRM_MAP_MAX_LOAD < capacity * 8) { cap *= 2; }
+
+    return cap <= m->cap || wrm_Map_rehash(m, cap);
+}
+
+void wrm_Map_clear(wrm_Map *m)
+{
+    if(!m || !m->ctrl) { return; }
+
+    memset(m->ctrl, WRM_MAP_EMPTY, m->cap);
+    m->len = 0;
+    m->deleted_cnt = 0;
+}
+
+void wrm_Map_delete(wrm_Map *m)
+{
+    if(!m) { return; }
+
+    if(m->ctrl) {
+        wrm_free(m->allocator, m->ctrl, wrm_Map_blockSize(m, m->cap, NULL, NULL));
+    }
+    *m = (wrm_Map){ 0 };
+}
+
+// file-internal helpers
+
+static bool wrm_Map_equalsBytes(const void *a, const void *b, size_t size)
+{
+    return memcmp(a, b, size) == 0;
+}
+
+/* Get a bit mask of the control bytes in `group` that equal `byte` */
+static u32 wrm_Map_match(const u8 *group, u8 byte)
+{
+#ifdef __SSE2__
+    __m128i ctrl = _mm_loadu_si128((const __m128i*)group);
+    return (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)byte)));
+#else
+    u32 mask = 0;
+    for(u32 i = 0; i < WRM_MAP_GROUP_SIZE; i++) {
+        mask |= (u32)(group[i] == byte) << i;
+    }
+    return mask;
+#endif
+}
+
+/* Get a bit mask of the slots in `group` that hold no entry: empty and deleted slots both have the high bit set */
+static u32 wrm_Map_matchFree(const u8 *group)
+{
+#ifdef __SSE2__
+    return (u32)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)group));
+#else
+    u32 mask = 0;
+    for(u32 i = 0; i < WRM_MAP_GROUP_SIZE; i++) {
+        mask |= (u32)(group[i] >> 7) << i;
+    }
+    return mask;
+#endif
+}
+
+/*
+Find the slot holding `key`, probing whole groups in a triangular sequence,
+which visits every group once since the group count is a power of two
+If `free_slot` is not NULL it receives the first slot along the way that a new entry could take
+*/
+static size_t wrm_Map_find(wrm_Map *m, const void *key, u64 hash, size_t *free_slot)
+{
+    size_t group_mask = m->cap / WRM_MAP_GROUP_SIZE - 1;
+    size_t g = (size_t)(hash >> 7) & group_mask;
+    u8 tag = (u8)(hash & 0x7f);
+
+    if(free_slot) { *free_slot = WRM_MAP_NOT_FOUND; }
+
+    for(size_t step = 1; step <= group_mask + 1; step++) {
+        const u8 *group = m->ctrl + g * WRM_MAP_GROUP_SIZE;
+
+        for(u32 bits = wrm_Map_match(group, tag); bits; bits &= bits - 1) {
+            size_t slot = g * WRM_MAP_GROUP_SIZE + (size_t)__builtin_ctz(bits);
+            if(m->equals(key, wrm_Map_keyAt(m, slot), m->key_size)) { return slot; }
+        }
+
+        if(free_slot && *free_slot == WRM_MAP_NOT_FOUND) {
+            u32 open = wrm_Map_matchFree(group);
+            if(open) { *free_slot = g * WRM_MAP_GROUP_SIZE + (size_t)__builtin_ctz(open); }
+        }
+
+        // an empty slot ends every probe sequence that could have placed the key further on
+        if(wrm_Map_match(group, WRM_MAP_EMPTY)) { return WRM_MAP_NOT_FOUND; }
+        g = (g + step) & group_mask;
+    }
+    return WRM_MAP_NOT_FOUND;
+}
+
+/* Move every entry into a new block of `capacity` slots, dropping deleted slots */
+static bool wrm_Map_rehash(wrm_Map *m, size_t capacity)
+{
+    size_t keys_at, values_at;
+    size_t bytes = wrm_Map_blockSize(m, capacity, &keys_at, &values_at);
+    u8 *block = wrm_alloc(m->allocator, bytes);
+    if(!block) { return false; }
+
+    wrm_Map old = *m;
+    m->ctrl = block;
+    m->keys = block + keys_at;
+    m->values = block + values_at;
+    m->cap = capacity;
+    m->deleted_cnt = 0;
+    memset(m->ctrl, WRM_MAP_EMPTY, capacity);
+
+    // keys are known to be distinct, so each only needs a free slot
+    wrm_Map_FOR_EACH(&old, i) {
+        void *key = wrm_Map_keyAt(&old, i);
+        u64 hash = m->hash(key, m->key_size);
+        size_t slot;
+        wrm_Map_find(m, key, hash, &slot);
+
+        m->ctrl[slot] = (u8)(hash & 0x7f);
+        memcpy(wrm_Map_keyAt(m, slot), key, m->key_size);
+        memcpy(wrm_Map_valueAt(m, slot), wrm_Map_valueAt(&old, i), m->value_size);
+    }
+
+    if(old.ctrl) {
+        wrm_free(m->allocator, old.ctrl, wrm_Map_blockSize(&old, old.cap, NULL, NULL));
+    }
+    return true;
+}
+
+/* Get the size of the block holding `capacity` slots, and where the keys and values start in it */
+static size_t wrm_Map_blockSize(wrm_Map *m, size_t capacity, size_t *keys_at, size_t *values_at)
+{
+    // `capacity` is a multiple of 16, so the keys stay aligned after the control bytes
+    size_t keys = capacity;
+    size_t values = keys + ((capacity * m->key_size + 15) & ~(size_t)15);
+    if(keys_at) { *keys_at = keys; }
+    if(values_at) { *values_at = values; }
+    return values + capacity * m->value_size;
+}
+
+// force the compiler to emit a symbol
+
+size_t wrm_Map_next(wrm_Map *m, size_t slot);
+void *wrm_Map_keyAt(wrm_Map *m, size_t slot);
+void *wrm_Map_valueAt(wrm_Map *m, size_t slot);
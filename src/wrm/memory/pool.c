@@ -1,115 +1,515 @@
 #include "wrm/memory.h"
 
+// pools that references can be resolved against, indexed by pool id
+static wrm_Pool *wrm_pool_registry[WRM_MEMORY_MAX_POOLS];
 
-bool wrm_Pool_init(wrm_Pool *p, size_t cap, size_t element_size, bool auto_reserve)
+// file-internal helper declarations
+static u32 wrm_Pool_register(wrm_Pool *p);
+static void wrm_Pool_unregister(wrm_Pool *p);
+static bool wrm_Pool_initSlots(wrm_Pool *p, size_t cap, size_t element_size, bool auto_reserve, bool dense, const wrm_Allocator *allocator);
+static bool wrm_Pool_initDone(wrm_Pool *p, bool ok);
+static bool wrm_Pool_resize(wrm_Pool *p, void **arr, size_t old_size, size_t new_size);
+static bool wrm_Pool_resizeAll(wrm_Pool *p, size_t capacity);
+static void wrm_Pool_markRows(wrm_Pool *p, size_t len);
+
+bool wrm_Pool_init(wrm_Pool *p, size_t cap, size_t element_size, bool auto_reserve, const wrm_Allocator *allocator)
 {
     if(!p) return false;
 
-    p->cap = cap;
-    p->e_size = element_size;
-    p->used_cnt = 0;
+    p->data = wrm_alloc(allocator, cap * element_size);
+    p->max_cap = 0;
 
-    p->data = calloc(cap, element_size);
-    p->in_use = calloc(cap, sizeof(bool));
-    p->auto_reserve = auto_reserve;
+    return wrm_Pool_initDone(p, wrm_Pool_initSlots(p, cap, element_size, auto_reserve, false, allocator) && p->data);
+}
+
+bool wrm_Pool_initVirtual(wrm_Pool *p, size_t cap, size_t max_cap, size_t element_size, const wrm_Allocator *allocator)
+{
+    if(!p || cap > max_cap) return false;
 
-    return p->data && p->in_use;
+    p->data = wrm_virtualReserve(max_cap * element_size);
+    p->max_cap = max_cap;
+
+    bool ok = wrm_Pool_initSlots(p, cap, element_size, true, false, allocator) && p->data && wrm_virtualCommit(p->data, cap * element_size);
+    return wrm_Pool_initDone(p, ok);
+}
+
+bool wrm_Pool_initDense(wrm_Pool *p, size_t cap, size_t element_size, bool auto_reserve, const wrm_Allocator *allocator)
+{
+    if(!p) return false;
+
+    p->data = wrm_alloc(allocator, cap * element_size);
+    p->max_cap = 0;
+
+    return wrm_Pool_initDone(p, wrm_Pool_initSlots(p, cap, element_size, auto_reserve, true, allocator) && p->data);
 }
 
 wrm_Option_Handle wrm_Pool_getSlot(wrm_Pool *p)
 {
-    if(p->used_cnt == p->cap) {
-        if(!(p->auto_reserve && wrm_Pool_reserve(p, p->cap * WRM_MEMORY_GROWTH_FACTOR))) {
-            return OPTION_NONE(Handle);
+    u32 i;
+
+    if(p->free_cnt) { // reuse the most recently freed slot
+        i = p->free_slots[--p->free_cnt];
+    }
+    else {
+        if(p->top == p->cap) {
+            size_t new_cap = p->cap ? p->cap * WRM_MEMORY_GROWTH_FACTOR : 1;
+            if(p->max_cap && new_cap > p->max_cap) { new_cap = p->max_cap; }
+            if(!(p->auto_reserve && new_cap > p->cap && wrm_Pool_reserve(p, new_cap))) {
+                return OPTION_NONE(Handle);
+            }
         }
-        p->in_use[p->used_cnt] = true;
-        memset(wrm_Pool_at(p, p->used_cnt), 0, p->e_size); // clear any prior data to zero
-        return OPTION_SOME(Handle, p->used_cnt++);
+        i = p->top++;
     }
 
-    size_t i = 0;
-    while(p->in_use[i]) { i++; }
-    p->in_use[i] = true;
+    wrm_bitSet(p->in_use, i, true);
+    p->gens[i]++;
+    if(p->packed_at) { // dense pools: append the item
+        p->packed_at[i] = p->used_cnt;
+        p->slot_of[p->used_cnt] = i;
+    }
+    wrm_Pool_touch(p, i);
     p->used_cnt++;
-    memset(wrm_Pool_at(p, i), 0, p->e_size);
+    if(p->used_cnt > p->peak) { p->peak = p->used_cnt; }
+    memset(wrm_Pool_at(p, i), 0, p->e_size); // clear any prior data to zero
     return OPTION_SOME(Handle, i);
 }
 
 bool wrm_Pool_reserve(wrm_Pool *p, size_t capacity)
 {
     if(capacity >= WRM_POOL_MAX_CAPACITY) return false;
-    // reallocate
-    void *temp = realloc(p->data, capacity * p->e_size );
-    if(!temp) { return false; }
-    p->data = temp;
+    if(capacity <= p->cap) return true;
+    if(p->max_cap && capacity > p->max_cap) return false;
 
-    temp = realloc(p->in_use, capacity * sizeof(bool));
-    if(!temp ) { return false; }
-    p->in_use = temp;
-    
-    p->cap = capacity;
-    return true;
+    return wrm_Pool_resizeAll(p, capacity);
 }
 
 bool wrm_Pool_shrink(wrm_Pool *p, size_t capacity)
 {
     if(capacity < p->used_cnt) return false;
+    if(capacity >= p->cap) return true;
 
-    // allocate a new, smaller pool
-    wrm_Pool new_pool;
-    wrm_Pool_init(&new_pool, capacity, p->e_size, p->auto_reserve);
+    // move every item below `used_cnt`, so that the tail can be released
+    if(!wrm_Pool_compact(p, NULL)) { return false; }
 
-    // copy (shallow) all the old elements over
-    for(u32 i = 0; i < p->cap; i++) {
-        if(p->in_use[i]) {
-            void *src = wrm_Pool_at(p, i); 
-            wrm_Option_Handle result = wrm_Pool_getSlot(&new_pool);
-            if(!result.exists) {
-                wrm_error("Pool", "shrink()", "could not copy all data from the old to the new buffer!!");
-                return false;
+    // slots that come back after a later reserve() must start past any
+    // generation handed out by the slots dropped now
+    for(size_t i = capacity; i < p->cap; i++) {
+        if(p->gens[i] >= p->gen_base) { p->gen_base = (p->gens[i] | 1) + 1; }
+    }
+
+    if(!wrm_Pool_resizeAll(p, capacity)) { return false; }
+
+    // elements past the new capacity are gone, so no snapshot can be restored by delta anymore
+    p->dirty_epoch = 0;
+    return true;
+}
+
+bool wrm_Pool_addIndexField(wrm_Pool *p, wrm_Pool *owner, size_t offset)
+{
+    if(!p || !owner || p->remap_cnt == WRM_POOL_MAX_REMAPS) { return false; }
+
+    p->remaps[p->remap_cnt++] = (wrm_Pool_Remap){ .owner = owner, .offset = offset };
+    return true;
+}
+
+bool wrm_Pool_addRemapHook(wrm_Pool *p, wrm_FUNC(hook, void, void *ctx, const u32 *remap, size_t len), void *ctx)
+{
+    if(!p || !hook || p->remap_cnt == WRM_POOL_MAX_REMAPS) { return false; }
+
+    p->remaps[p->remap_cnt++] = (wrm_Pool_Remap){ .hook = hook, .ctx = ctx };
+    return true;
+}
+
+void wrm_Pool_removeRemaps(wrm_Pool *p, const void *key)
+{
+    if(!p) { return; }
+
+    u32 kept = 0;
+    for(u32 r = 0; r < p->remap_cnt; r++) {
+        wrm_Pool_Remap *m = &p->remaps[r];
+        if(m->hook ? m->ctx == key : (const void*)m->owner == key) { continue; }
+        p->remaps[kept++] = *m;
+    }
+    p->remap_cnt = kept;
+}
+
+bool wrm_Pool_compact(wrm_Pool *p, u32 *remap)
+{
+    if(!p) { return false; }
+
+    size_t len = p->top;
+    u32 *table = remap;
+    if(!table && p->remap_cnt) { // the registered fields still need a table
+        table = wrm_alloc(p->allocator, len * sizeof(u32));
+        if(!table) { return false; }
+    }
+    if(table) {
+        for(size_t i = 0; i < len; i++) { table[i] = WRM_POOL_NO_SLOT; }
+    }
+
+    // a slot that receives a moved item gets an odd generation it has never
+    // had, so references to whatever was there before stay stale
+    u32 n = (u32)p->used_cnt;
+    if(p->packed_at) { // dense: the items are already packed, only their slots change
+        for(u32 pos = 0; pos < n; pos++) {
+            u32 slot = p->slot_of[pos];
+            if(table) { table[slot] = pos; }
+            if(slot != pos) { p->gens[pos] = (p->gens[pos] + 1) | 1; }
+            p->slot_of[pos] = pos;
+            p->packed_at[pos] = pos;
+        }
+    }
+    else {
+        u32 dest = 0;
+        wrm_Pool_FOR_EACH(p, i) {
+            if(table) { table[i] = dest; }
+            if(i != dest) {
+                memcpy(wrm_Pool_slotData(p, dest), wrm_Pool_slotData(p, i), p->e_size);
+                p->gens[dest] = (p->gens[dest] + 1) | 1;
             }
-            void *dest = wrm_Pool_at(&new_pool, result.val);
-            memcpy(dest, src, p->e_size);
+            dest++;
         }
     }
 
-    // just to be sure
-    if(new_pool.used_cnt != p->used_cnt) {
-        wrm_error("Pool", "shrink()", "could not copy all data from the old to the new buffer!!");
-        return false;
+    wrm_Pool_markRows(p, len);
+
+    // slots past the live items are free now: a slot whose item moved away is
+    // still at its odd (live) generation
+    for(size_t i = n; i < len; i++) {
+        if(p->gens[i] & 1) { p->gens[i]++; }
+    }
+    memset(p->in_use, 0, wrm_BIT_WORDS(p->cap) * sizeof(u64));
+    for(u32 i = 0; i < n; i++) { wrm_bitSet(p->in_use, i, true); }
+    p->free_cnt = 0;
+    p->top = n;
+
+    // rewrite everything that stores slot indices of `p`
+    for(u32 r = 0; r < p->remap_cnt; r++) {
+        wrm_Pool_Remap *m = &p->remaps[r];
+        if(m->hook) {
+            m->hook(m->ctx, table, len);
+            continue;
+        }
+        wrm_Pool_FOR_EACH(m->owner, i) {
+            u32 *field = (u32*)((u8*)wrm_Pool_slotData(m->owner, i) + m->offset);
+            if(*field < len) { *field = table[*field]; }
+        }
     }
 
-    // delete (shallow) old resources and swap
-    wrm_Pool_delete(p, NULL);
-    *p = new_pool;
+    if(!remap) { wrm_free(p->allocator, table, len * sizeof(u32)); }
     return true;
 }
 
 void wrm_Pool_delete(wrm_Pool *p, void (*delete)(void *element))
 {
-    if(!p || !p->data || !p->in_use) { return; }
+    if(!p) { return; }
+
+    // before anything else: a pool whose init failed holds no elements, but may hold an id
+    wrm_Pool_unregister(p);
+    wrm_memoryUntrack(p);
 
-    if(delete) {
-        for(u32 i = 0; i < p->cap; i++) {
-            if(p->in_use[i]) delete(wrm_Pool_at(p, i)); 
+    if(delete && p->data && p->in_use) {
+        wrm_Pool_FOR_EACH(p, i) {
+            delete(wrm_Pool_at(p, i)); 
         }
     }
-    
 
-    free(p->data);
-    free(p->in_use);
+    // any of the arrays may be missing after a failed init
+    const wrm_Allocator *a = p->allocator;
+    if(p->max_cap) {
+        if(p->data) { wrm_virtualRelease(p->data, p->max_cap * p->e_size); }
+    }
+    else { wrm_free(a, p->data, p->cap * p->e_size); }
+    wrm_free(a, p->in_use, wrm_BIT_WORDS(p->cap) * sizeof(u64));
+    wrm_free(a, p->free_slots, p->cap * sizeof(u32));
+    wrm_free(a, p->gens, p->cap * sizeof(u32));
+    wrm_free(a, p->packed_at, p->cap * sizeof(u32));
+    wrm_free(a, p->slot_of, p->cap * sizeof(u32));
+    wrm_free(a, p->dirty, wrm_BIT_WORDS(p->cap) * sizeof(u64));
 
     p->data = NULL;
     p->in_use = NULL;
+    p->free_slots = NULL;
+    p->gens = NULL;
+    p->packed_at = NULL;
+    p->slot_of = NULL;
+    p->dirty = NULL;
 
     p->used_cnt = 0;
+    p->free_cnt = 0;
+    p->top = 0;
     p->e_size = 0;
     p->cap = 0;
+    p->max_cap = 0;
+    p->remap_cnt = 0;
+}
+
+bool wrm_Pool_snapshot(wrm_Pool *p, wrm_Pool_Snapshot *snap, bool track)
+{
+    if(!p || !snap) { return false; }
+
+    // dense pools only hold items in the first `used_cnt` places of `data`
+    size_t rows = p->packed_at ? p->used_cnt : p->top;
+    size_t words = wrm_BIT_WORDS(p->cap);
+    size_t data_size = (rows * p->e_size + 7) & ~(size_t)7; // keep the bit vector aligned after it
+    size_t u32_arrays = p->packed_at ? 4 : 2;
+    size_t size = data_size + words * sizeof(u64) + u32_arrays * p->cap * sizeof(u32);
+
+    if(!snap->block || snap->block_size < size || snap->allocator != p->allocator) {
+        wrm_Pool_Snapshot_delete(snap);
+        snap->block = wrm_alloc(p->allocator, size);
+        if(!snap->block) { return false; }
+        snap->block_size = size;
+        snap->allocator = p->allocator;
+    }
+
+    snap->data = snap->block;
+    snap->in_use = (u64*)(snap->block + data_size);
+    snap->gens = (u32*)(snap->in_use + words);
+    snap->free_slots = snap->gens + p->cap;
+    snap->packed_at = p->packed_at ? snap->free_slots + p->cap : NULL;
+    snap->slot_of = p->packed_at ? snap->packed_at + p->cap : NULL;
+
+    memcpy(snap->data, p->data, rows * p->e_size);
+    memcpy(snap->in_use, p->in_use, words * sizeof(u64));
+    memcpy(snap->gens, p->gens, p->cap * sizeof(u32));
+    memcpy(snap->free_slots, p->free_slots, p->free_cnt * sizeof(u32));
+    if(p->packed_at) {
+        memcpy(snap->packed_at, p->packed_at, p->cap * sizeof(u32));
+        memcpy(snap->slot_of, p->slot_of, p->cap * sizeof(u32));
+    }
+
+    snap->e_size = p->e_size;
+    snap->cap = p->cap;
+    snap->used_cnt = p->used_cnt;
+    snap->free_cnt = p->free_cnt;
+    snap->top = p->top;
+    snap->gen_base = p->gen_base;
+    snap->epoch = 0;
+
+    if(track) {
+        if(!p->dirty) {
+            p->dirty = wrm_alloc(p->allocator, words * sizeof(u64));
+            if(!p->dirty) { return false; }
+        }
+        memset(p->dirty, 0, words * sizeof(u64));
+        snap->epoch = ++p->snapshot_cnt;
+        p->dirty_epoch = snap->epoch;
+    }
+    return true;
+}
+
+bool wrm_Pool_restore(wrm_Pool *p, const wrm_Pool_Snapshot *snap, bool delta)
+{
+    if(!p || !snap || !snap->block || snap->e_size != p->e_size || !snap->packed_at != !p->packed_at) { return false; }
+
+    // clean elements only match the snapshot the pool has been tracking since
+    delta = delta && p->dirty && snap->epoch && snap->epoch == p->dirty_epoch;
+    if(!delta && !wrm_Pool_reserve(p, snap->cap)) { return false; }
+
+    u32 rows = (u32)(p->packed_at ? snap->used_cnt : snap->top);
+    if(delta) {
+        for(u32 i = wrm_bitNext(p->dirty, 0, rows); i < rows; i = wrm_bitNext(p->dirty, i + 1, rows)) {
+            memcpy((u8*)p->data + i * p->e_size, snap->data + i * p->e_size, p->e_size);
+        }
+    }
+    else {
+        memcpy(p->data, snap->data, rows * p->e_size);
+    }
+
+    size_t words = wrm_BIT_WORDS(snap->cap);
+    memcpy(p->in_use, snap->in_use, words * sizeof(u64));
+    memcpy(p->free_slots, snap->free_slots, snap->free_cnt * sizeof(u32));
+    if(p->packed_at) {
+        memcpy(p->packed_at, snap->packed_at, snap->cap * sizeof(u32));
+        memcpy(p->slot_of, snap->slot_of, snap->cap * sizeof(u32));
+    }
+
+    // only slots live in the snapshot get their generation back; the rest are free
+    // again at their current one, made even, so that references taken since stay
+    // stale even once those slots are handed out anew
+    memset(p->in_use + words, 0, (wrm_BIT_WORDS(p->cap) - words) * sizeof(u64));
+    for(u32 i = 0; i < p->cap; i++) {
+        if(i < snap->cap && wrm_bitAt(snap->in_use, i)) { p->gens[i] = snap->gens[i]; }
+        else if(p->gens[i] & 1) { p->gens[i]++; }
+    }
+
+    p->used_cnt = snap->used_cnt;
+    p->free_cnt = snap->free_cnt;
+    p->top = snap->top;
+    // never lowered, for the same reason
+    if(snap->gen_base > p->gen_base) { p->gen_base = snap->gen_base; }
+
+    // the pool matches `snap` again
+    if(p->dirty) {
+        memset(p->dirty, 0, wrm_BIT_WORDS(p->cap) * sizeof(u64));
+        p->dirty_epoch = snap->epoch;
+    }
+    return true;
+}
+
+void wrm_Pool_Snapshot_delete(wrm_Pool_Snapshot *snap)
+{
+    if(!snap) { return; }
+
+    wrm_free(snap->allocator, snap->block, snap->block_size);
+    *snap = (wrm_Pool_Snapshot){ 0 };
+}
+
+void *wrm_deref(wrm_Ref ref)
+{
+    if(ref.src >= WRM_MEMORY_MAX_POOLS || !wrm_pool_registry[ref.src]) { return NULL; }
+    return wrm_Pool_deref(wrm_pool_registry[ref.src], ref);
+}
+
+// file-internal helpers
+
+/* Set up everything but `data` for a pool of `cap` slots; the pool is not registered yet */
+static bool wrm_Pool_initSlots(wrm_Pool *p, size_t cap, size_t element_size, bool auto_reserve, bool dense, const wrm_Allocator *allocator)
+{
+    p->cap = cap;
+    p->e_size = element_size;
+    p->used_cnt = 0;
+
+    p->free_cnt = 0;
+    p->top = 0;
+
+    p->in_use = wrm_alloc(allocator, wrm_BIT_WORDS(cap) * sizeof(u64));
+    p->free_slots = wrm_alloc(allocator, cap * sizeof(u32));
+    p->gens = wrm_alloc(allocator, cap * sizeof(u32));
+    p->packed_at = dense ? wrm_alloc(allocator, cap * sizeof(u32)) : NULL;
+    p->slot_of = dense ? wrm_alloc(allocator, cap * sizeof(u32)) : NULL;
+    p->auto_reserve = auto_reserve;
+    p->allocator = allocator;
+    p->remap_cnt = 0;
+    p->gen_base = 0;
+    p->dirty = NULL;
+    p->dirty_epoch = 0;
+    p->snapshot_cnt = 0;
+    p->peak = 0;
+    p->realloc_cnt = 0;
+    p->realloc_bytes = 0;
+    p->id = WRM_POOL_NO_ID;
+
+    return p->in_use && p->free_slots && p->gens && (!dense || (p->packed_at && p->slot_of));
+}
+
+/* Register pool `p` once all of its init succeeded (`ok`), or give back whatever it did get */
+static bool wrm_Pool_initDone(wrm_Pool *p, bool ok)
+{
+    if(!ok) {
+        wrm_Pool_delete(p, NULL);
+        return false;
+    }
+    p->id = wrm_Pool_register(p);
+    return true;
+}
+
+/* Resize the array at `*arr` of pool `p` from `old_size` to `new_size` bytes, leaving it untouched on failure */
+static bool wrm_Pool_resize(wrm_Pool *p, void **arr, size_t old_size, size_t new_size)
+{
+    void *temp = wrm_realloc(p->allocator, *arr, old_size, new_size);
+    if(!temp) { return false; }
+    *arr = temp;
+    p->realloc_bytes += old_size < new_size ? old_size : new_size;
+    return true;
+}
+
+/*
+Resize every array of pool `p` to `capacity` slots
+The bookkeeping arrays are allocated anew, and `data` is resized last: nothing
+is swapped in until all of it succeeded, so on failure every array still
+matches `p->cap`, which sized allocators rely on when the arrays are freed
+*/
+static bool wrm_Pool_resizeAll(wrm_Pool *p, size_t capacity)
+{
+    const wrm_Allocator *a = p->allocator;
+    size_t old_words = wrm_BIT_WORDS(p->cap);
+    size_t new_words = wrm_BIT_WORDS(capacity);
+
+    // the dense and snapshot arrays are only there for some pools
+    void **arrays[] = { (void**)&p->in_use, (void**)&p->free_slots, (void**)&p->gens, (void**)&p->packed_at, (void**)&p->slot_of, (void**)&p->dirty };
+    size_t old_sizes[] = { old_words * sizeof(u64), p->cap * sizeof(u32), p->cap * sizeof(u32), p->cap * sizeof(u32), p->cap * sizeof(u32), old_words * sizeof(u64) };
+    size_t new_sizes[] = { new_words * sizeof(u64), capacity * sizeof(u32), capacity * sizeof(u32), capacity * sizeof(u32), capacity * sizeof(u32), new_words * sizeof(u64) };
+    void *resized[6] = { 0 };
+
+    bool ok = true;
+    for(u32 i = 0; i < 6 && ok; i++) {
+        if(!*arrays[i]) { continue; }
+        resized[i] = wrm_alloc(a, new_sizes[i]);
+        ok = resized[i] != NULL;
+    }
+    if(ok && p->max_cap) { // virtual pools: commit or decommit in place
+        if(capacity > p->cap) { ok = wrm_virtualCommit(p->data, capacity * p->e_size); }
+        else { wrm_virtualDecommit(p->data, capacity * p->e_size, p->cap * p->e_size); }
+    }
+    else if(ok) {
+        ok = wrm_Pool_resize(p, &p->data, p->cap * p->e_size, capacity * p->e_size);
+    }
+    if(!ok) {
+        for(u32 i = 0; i < 6; i++) { wrm_free(a, resized[i], new_sizes[i]); }
+        return false;
+    }
+
+    for(u32 i = 0; i < 6; i++) {
+        if(!resized[i]) { continue; }
+        size_t keep = old_sizes[i] < new_sizes[i] ? old_sizes[i] : new_sizes[i];
+        memcpy(resized[i], *arrays[i], keep);
+        memset((u8*)resized[i] + keep, 0, new_sizes[i] - keep);
+        wrm_free(a, *arrays[i], old_sizes[i]);
+        *arrays[i] = resized[i];
+        p->realloc_bytes += keep;
+    }
+    for(size_t i = p->cap; i < capacity; i++) { p->gens[i] = p->gen_base; }
+
+    p->cap = capacity;
+    p->realloc_cnt++;
+    return true;
+}
+
+/* Mark the first `len` elements of `data` of pool `p` as written */
+static void wrm_Pool_markRows(wrm_Pool *p, size_t len)
+{
+    if(!p->dirty) { return; }
+    for(size_t w = 0; w < len / 64; w++) { p->dirty[w] = ~(u64)0; }
+    if(len % 64) { p->dirty[len / 64] |= ((u64)1 << (len % 64)) - 1; }
+}
+
+static u32 wrm_Pool_register(wrm_Pool *p)
+{
+    // a pool initialized again without being deleted keeps its one entry
+    u32 id = WRM_POOL_NO_ID;
+    for(u32 i = 0; i < WRM_MEMORY_MAX_POOLS; i++) {
+        if(wrm_pool_registry[i] == p) { return i; }
+        if(!wrm_pool_registry[i] && id == WRM_POOL_NO_ID) { id = i; }
+    }
+    if(id != WRM_POOL_NO_ID) { wrm_pool_registry[id] = p; }
+    return id; // without an id the pool is still usable, but references to it won't resolve through wrm_deref()
+}
+
+static void wrm_Pool_unregister(wrm_Pool *p)
+{
+    // searched for rather than found by `id`, which a pool that failed to initialize may not have set
+    for(u32 i = 0; i < WRM_MEMORY_MAX_POOLS; i++) {
+        if(wrm_pool_registry[i] == p) { wrm_pool_registry[i] = NULL; }
+    }
+    p->id = WRM_POOL_NO_ID;
 }
 
 // force the compiler to emit a symbol for these
 
+bool wrm_bitAt(const u64 *bit_vec, u32 idx);
+void wrm_bitSet(u64 *bit_vec, u32 idx, bool val);
+u32 wrm_bitNext(const u64 *bit_vec, u32 idx, u32 len);
 bool wrm_Pool_isValid(wrm_Pool *p, wrm_Handle idx);
+u32 wrm_Pool_nextUsed(wrm_Pool *p, u32 idx);
+void *wrm_Pool_slotData(wrm_Pool *p, wrm_Handle idx);
+void *wrm_Pool_packedAt(wrm_Pool *p, u32 pos);
 void wrm_Pool_freeSlot(wrm_Pool *p, wrm_Handle idx);
+void wrm_Pool_touch(wrm_Pool *p, wrm_Handle idx);
 void *wrm_Pool_offsetAt(wrm_Pool *p, wrm_Handle idx, size_t offset);
 void *wrm_Pool_at(wrm_Pool *p, wrm_Handle idx);
+const void *wrm_Pool_peek(wrm_Pool *p, wrm_Handle idx);
+const void *wrm_Pool_peekRef(wrm_Pool *p, wrm_Ref ref);
+wrm_Option_Ref wrm_Pool_getRef(wrm_Pool *p, wrm_Handle idx);
+void *wrm_Pool_deref(wrm_Pool *p, wrm_Ref ref);
@@ -0,0 +1,161 @@
+#include "wrm/memory.h"
+
+// file-internal helper declarations
+static wrm_Ring_Span wrm_Ring_span(wrm_Ring *r, u64 pos, size_t cnt);
+static size_t wrm_Ring_fit(wrm_Ring *r, u64 pos, u64 avail, size_t n);
+
+bool wrm_Ring_init(wrm_Ring *r, size_t capacity, size_t element_size, bool multi_producer, const wrm_Allocator *allocator)
+{
+    if(!r || !capacity || !element_size) return false;
+
+    u64 cap = 1;
+    while(cap < capacity) { cap <<= 1; }
+
+    r->e_size = element_size;
+    r->cap = cap;
+    r->mask = cap - 1;
+    r->multi_producer = multi_producer;
+    r->allocator = allocator;
+
+    atomic_init(&r->head, 0);
+    atomic_init(&r->published, 0);
+    atomic_init(&r->tail, 0);
+    r->tail_cache = 0;
+    r->published_cache = 0;
+
+    r->data = wrm_alloc(allocator, cap * element_size);
+    // zeroed, which never matches a position + 1 until the element is written
+    r->ready = multi_producer ? wrm_alloc(allocator, cap * sizeof(_Atomic u32)) : NULL;
+    return r->data && (r->ready || !multi_producer);
+}
+
+wrm_Ring_Span wrm_Ring_reserve(wrm_Ring *r, size_t n)
+{
+    u64 head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    size_t cnt;
+
+    if(!r->multi_producer) {
+        // the head is this thread's alone; only look at the tail when the cached one says full
+        if(r->cap - (head - r->tail_cache) < n) {
+            r->tail_cache = atomic_load_explicit(&r->tail, memory_order_acquire);
+        }
+        cnt = wrm_Ring_fit(r, head, r->cap - (head - r->tail_cache), n);
+        atomic_store_explicit(&r->head, head + cnt, memory_order_relaxed);
+        return wrm_Ring_span(r, head, cnt);
+    }
+
+    // claim the positions against the other producers
+    do {
+        u64 tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+        cnt = wrm_Ring_fit(r, head, r->cap - (head - tail), n);
+        if(!cnt) { break; }
+    } while(!atomic_compare_exchange_weak_explicit(&r->head, &head, head + cnt, memory_order_relaxed, memory_order_relaxed));
+
+    return wrm_Ring_span(r, head, cnt);
+}
+
+void wrm_Ring_commit(wrm_Ring *r, wrm_Ring_Span span)
+{
+    if(!span.cnt) { return; }
+
+    if(!r->multi_producer) {
+        atomic_store_explicit(&r->published, span.pos + span.cnt, memory_order_release);
+        return;
+    }
+
+    // mark each element, so producers never wait on each other's commits
+    for(size_t i = 0; i < span.cnt; i++) {
+        u64 pos = span.pos + i;
+        atomic_store_explicit(&r->ready[pos & r->mask], (u32)(pos + 1), memory_order_release);
+    }
+}
+
+wrm_Ring_Span wrm_Ring_peek(wrm_Ring *r, size_t n)
+{
+    u64 tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+
+    if(r->multi_producer) {
+        // take the committed run from the tail; the slot after it is still being written
+        size_t cnt = 0;
+        size_t max = wrm_Ring_fit(r, tail, r->cap, n);
+        while(cnt < max && atomic_load_explicit(&r->ready[(tail + cnt) & r->mask], memory_order_acquire) == (u32)(tail + cnt + 1)) {
+            cnt++;
+        }
+        return wrm_Ring_span(r, tail, cnt);
+    }
+
+    if(r->published_cache - tail < n) {
+        r->published_cache = atomic_load_explicit(&r->published, memory_order_acquire);
+    }
+    size_t cnt = wrm_Ring_fit(r, tail, r->published_cache - tail, n);
+    return wrm_Ring_span(r, tail, cnt);
+}
+
+void wrm_Ring_release(wrm_Ring *r, wrm_Ring_Span span)
+{
+    if(!span.cnt) { return; }
+    atomic_store_explicit(&r->tail, span.pos + span.cnt, memory_order_release);
+}
+
+size_t wrm_Ring_push(wrm_Ring *r, const void *items, size_t n)
+{
+    const u8 *src = items;
+    size_t done = 0;
+
+    // at most two spans: up to the end of the array, then from the start
+    while(done < n) {
+        wrm_Ring_Span span = wrm_Ring_reserve(r, n - done);
+        if(!span.cnt) { break; }
+
+        memcpy(span.data, src + done * r->e_size, span.cnt * r->e_size);
+        wrm_Ring_commit(r, span);
+        done += span.cnt;
+    }
+    return done;
+}
+
+size_t wrm_Ring_pop(wrm_Ring *r, void *items, size_t n)
+{
+    u8 *dest = items;
+    size_t done = 0;
+
+    while(done < n) {
+        wrm_Ring_Span span = wrm_Ring_peek(r, n - done);
+        if(!span.cnt) { break; }
+
+        memcpy(dest + done * r->e_size, span.data, span.cnt * r->e_size);
+        wrm_Ring_release(r, span);
+        done += span.cnt;
+    }
+    return done;
+}
+
+void wrm_Ring_delete(wrm_Ring *r)
+{
+    if(!r || !r->data) { return; }
+
+    wrm_free(r->allocator, r->data, r->cap * r->e_size);
+    wrm_free(r->allocator, r->ready, r->cap * sizeof(_Atomic u32));
+    r->data = NULL;
+    r->ready = NULL;
+    r->cap = 0;
+}
+
+// file-internal helpers
+
+static wrm_Ring_Span wrm_Ring_span(wrm_Ring *r, u64 pos, size_t cnt)
+{
+    return (wrm_Ring_Span){ .data = r->data + (pos & r->mask) * r->e_size, .pos = pos, .cnt = cnt };
+}
+
+/* Get how many of `n` elements from `pos` can be used: no more than `avail`, and not past the end of the array */
+static size_t wrm_Ring_fit(wrm_Ring *r, u64 pos, u64 avail, size_t n)
+{
+    u64 to_end = r->cap - (pos & r->mask);
+    if(avail > to_end) { avail = to_end; }
+    return n < avail ? n : (size_t)avail;
+}
+
+// force the compiler to emit a symbol
+
+size_t wrm_Ring_len(wrm_Ring *r);
@@ -0,0 +1,118 @@
+#include "wrm/memory.h"
+
+// file-internal helper declarations
+static void *wrm_Slab_Allocator_alloc(void *ctx, size_t size);
+static void *wrm_Slab_Allocator_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size);
+static void wrm_Slab_Allocator_free(void *ctx, void *ptr, size_t size);
+static bool wrm_Slab_Allocator_newSlab(wrm_Slab_Allocator *s, u32 class);
+
+void wrm_Slab_Allocator_init(wrm_Slab_Allocator *s, const wrm_Allocator *parent)
+{
+    if(!s) { return; }
+
+    *s = (wrm_Slab_Allocator) {
+        .allocator = {
+            .alloc = wrm_Slab_Allocator_alloc,
+            .realloc = wrm_Slab_Allocator_realloc,
+            .free = wrm_Slab_Allocator_free,
+            .ctx = s
+        },
+        .parent = parent
+    };
+}
+
+void wrm_Slab_Allocator_delete(wrm_Slab_Allocator *s)
+{
+    if(!s) { return; }
+
+    for(size_t i = 0; i < s->slab_cnt; i++) {
+        wrm_virtualRelease(s->slabs[i], WRM_SLAB_BYTES);
+    }
+    wrm_free(s->parent, s->slabs, s->slab_cap * sizeof(void*));
+
+    wrm_Slab_Allocator_init(s, s->parent);
+}
+
+// file-internal helpers
+
+static void *wrm_Slab_Allocator_alloc(void *ctx, size_t size)
+{
+    wrm_Slab_Allocator *s = ctx;
+    if(size > WRM_SLAB_MAX_SIZE) { return wrm_alloc(s->parent, size); }
+
+    u32 class = wrm_Slab_class(size);
+    void *block = s->free_lists[class];
+
+    if(block) { // reuse a freed block: it must be cleared
+        s->free_lists[class] = *(void**)block;
+        memset(block, 0, size);
+        return block;
+    }
+
+    // carve a fresh block, which is still zero from the page mapping
+    size_t block_size = (size_t)WRM_SLAB_MIN_SIZE << class;
+    if(s->next[class] == s->end[class] && !wrm_Slab_Allocator_newSlab(s, class)) {
+        return NULL;
+    }
+    block = s->next[class];
+    s->next[class] += block_size;
+    return block;
+}
+
+static void *wrm_Slab_Allocator_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size)
+{
+    wrm_Slab_Allocator *s = ctx;
+    if(!ptr) { return wrm_Slab_Allocator_alloc(s, new_size); }
+
+    bool old_small = old_size <= WRM_SLAB_MAX_SIZE;
+    bool new_small = new_size <= WRM_SLAB_MAX_SIZE;
+
+    if(!old_small && !new_small) { return wrm_realloc(s->parent, ptr, old_size, new_size); }
+    if(old_small && new_small && wrm_Slab_class(old_size) == wrm_Slab_class(new_size)) { return ptr; }
+
+    // moving between classes, or between slabs and the parent
+    void *new_ptr = wrm_Slab_Allocator_alloc(s, new_size);
+    if(!new_ptr) { return NULL; }
+    memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+    wrm_Slab_Allocator_free(s, ptr, old_size);
+    return new_ptr;
+}
+
+static void wrm_Slab_Allocator_free(void *ctx, void *ptr, size_t size)
+{
+    wrm_Slab_Allocator *s = ctx;
+    if(size > WRM_SLAB_MAX_SIZE) {
+        wrm_free(s->parent, ptr, size);
+        return;
+    }
+
+    u32 class = wrm_Slab_class(size);
+    *(void**)ptr = s->free_lists[class];
+    s->free_lists[class] = ptr;
+}
+
+static bool wrm_Slab_Allocator_newSlab(wrm_Slab_Allocator *s, u32 class)
+{
+    if(s->slab_cnt == s->slab_cap) {
+        size_t new_cap = s->slab_cap ? s->slab_cap * WRM_MEMORY_GROWTH_FACTOR : 16;
+        void *temp = wrm_realloc(s->parent, s->slabs, s->slab_cap * sizeof(void*), new_cap * sizeof(void*));
+        if(!temp) { return false; }
+        s->slabs = temp;
+        s->slab_cap = new_cap;
+    }
+
+    u8 *slab = wrm_virtualReserve(WRM_SLAB_BYTES);
+    if(!wrm_virtualCommit(slab, WRM_SLAB_BYTES)) {
+        wrm_virtualRelease(slab, WRM_SLAB_BYTES);
+        return false;
+    }
+
+    s->slabs[s->slab_cnt++] = slab;
+    s->next[class] = slab;
+    s->end[class] = slab + WRM_SLAB_BYTES;
+    return true;
+}
+
+// force the compiler to emit a symbol
+
+u32 wrm_Slab_class(size_t size);
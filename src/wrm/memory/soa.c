@@ -0,0 +1,124 @@
+#include "wrm/memory.h"
+
+// file-internal helper declarations
+static void wrm_Soa_Pool_moveFields(void *ctx, const u32 *remap, size_t len);
+
+bool wrm_Soa_Pool_init(wrm_Soa_Pool *s, size_t capacity, const size_t *field_sizes, u32 field_cnt, bool auto_reserve, const wrm_Allocator *allocator)
+{
+    if(!s || !field_sizes || !field_cnt || field_cnt > WRM_SOA_MAX_FIELDS) { return false; }
+    for(u32 f = 0; f < field_cnt; f++) {
+        if(!field_sizes[f]) { return false; }
+    }
+
+    *s = (wrm_Soa_Pool){ .field_cnt = field_cnt, .auto_reserve = auto_reserve };
+
+    // the slot pool never grows by itself, so that it cannot get ahead of the other fields
+    if(!wrm_Pool_init(&s->slots, capacity, field_sizes[0], false, allocator)) { return false; }
+    s->fields[0] = s->slots.data;
+    s->sizes[0] = field_sizes[0];
+
+    for(u32 f = 1; f < field_cnt; f++) {
+        s->sizes[f] = field_sizes[f];
+        s->fields[f] = wrm_alloc(allocator, capacity * field_sizes[f]);
+        if(!s->fields[f]) {
+            wrm_Soa_Pool_delete(s); // also takes the slot pool out of the registry
+            return false;
+        }
+    }
+
+    // registered first, so the other fields have moved by the time anyone else's hooks run
+    return field_cnt == 1 || wrm_Pool_addRemapHook(&s->slots, wrm_Soa_Pool_moveFields, s);
+}
+
+wrm_Option_Handle wrm_Soa_Pool_getSlot(wrm_Soa_Pool *s)
+{
+    wrm_Pool *p = &s->slots;
+
+    if(!p->free_cnt && p->top == p->cap) {
+        size_t new_cap = p->cap ? p->cap * WRM_MEMORY_GROWTH_FACTOR : 1;
+        if(!(s->auto_reserve && wrm_Soa_Pool_reserve(s, new_cap))) {
+            return OPTION_NONE(Handle);
+        }
+    }
+
+    // the slot pool zeroes field 0
+    wrm_Option_Handle result = wrm_Pool_getSlot(p);
+    if(!result.exists) { return result; }
+
+    for(u32 f = 1; f < s->field_cnt; f++) {
+        memset(s->fields[f] + result.val * s->sizes[f], 0, s->sizes[f]);
+    }
+    return result;
+}
+
+bool wrm_Soa_Pool_reserve(wrm_Soa_Pool *s, size_t capacity)
+{
+    if(capacity >= WRM_POOL_MAX_CAPACITY) return false;
+    size_t cap = s->slots.cap;
+    if(capacity <= cap) return true;
+
+    // new arrays are only swapped in once the slot pool has grown too, so a failure
+    // anywhere leaves every field at the slot pool's capacity, which they are freed with
+    const wrm_Allocator *a = s->slots.allocator;
+    u8 *grown[WRM_SOA_MAX_FIELDS] = { 0 };
+    u32 f = 1;
+    for(; f < s->field_cnt; f++) {
+        grown[f] = wrm_alloc(a, capacity * s->sizes[f]);
+        if(!grown[f]) { break; }
+    }
+
+    if(f < s->field_cnt || !wrm_Pool_reserve(&s->slots, capacity)) {
+        for(u32 g = 1; g < f; g++) { wrm_free(a, grown[g], capacity * s->sizes[g]); }
+        return false;
+    }
+
+    for(f = 1; f < s->field_cnt; f++) {
+        memcpy(grown[f], s->fields[f], cap * s->sizes[f]);
+        wrm_free(a, s->fields[f], cap * s->sizes[f]);
+        s->fields[f] = grown[f];
+        s->slots.realloc_bytes += cap * s->sizes[f];
+    }
+    s->fields[0] = s->slots.data;
+    return true;
+}
+
+bool wrm_Soa_Pool_compact(wrm_Soa_Pool *s, u32 *remap)
+{
+    if(!s) { return false; }
+
+    // moves field 0, then the others through the remap hook
+    return wrm_Pool_compact(&s->slots, remap);
+}
+
+void wrm_Soa_Pool_delete(wrm_Soa_Pool *s)
+{
+    if(!s) { return; }
+
+    for(u32 f = 1; f < s->field_cnt; f++) {
+        wrm_free(s->slots.allocator, s->fields[f], s->slots.cap * s->sizes[f]);
+    }
+    wrm_Pool_delete(&s->slots, NULL);
+    *s = (wrm_Soa_Pool){ 0 };
+}
+
+// file-internal helpers
+
+/* Remap hook of the slot pool: move fields 1 and up the way field 0 was moved */
+static void wrm_Soa_Pool_moveFields(void *ctx, const u32 *remap, size_t len)
+{
+    wrm_Soa_Pool *s = ctx;
+
+    // items only ever move down, so going up never overwrites one that has yet to move
+    for(u32 f = 1; f < s->field_cnt; f++) {
+        size_t size = s->sizes[f];
+        for(size_t i = 0; i < len; i++) {
+            if(remap[i] == WRM_POOL_NO_SLOT || remap[i] == i) { continue; }
+            memcpy(s->fields[f] + remap[i] * size, s->fields[f] + i * size, size);
+        }
+    }
+}
+
+// force the compiler to emit a symbol
+
+void *wrm_Soa_Pool_at(wrm_Soa_Pool *s, u32 field, wrm_Handle idx);
+void wrm_Soa_Pool_freeSlot(wrm_Soa_Pool *s, wrm_Handle idx);
@@ -0,0 +1,48 @@
+#include "wrm/memory.h"
+
+// buckets of each radix sort pass
+#define WRM_SORT_BUCKETS (1 << WRM_SORT_RADIX_BITS)
+// passes needed to cover a 64-bit key
+#define WRM_SORT_PASSES (64 / WRM_SORT_RADIX_BITS)
+
+void wrm_radixSort(wrm_Sort_Key *keys, wrm_Sort_Key *tmp, size_t n)
+{
+    if(!keys || !tmp || n < 2) { return; }
+
+    // count every pass's digits in one read of the keys
+    size_t counts[WRM_SORT_PASSES][WRM_SORT_BUCKETS] = { 0 };
+    for(size_t i = 0; i < n; i++) {
+        u64 key = keys[i].key;
+        for(u32 pass = 0; pass < WRM_SORT_PASSES; pass++) {
+            counts[pass][(key >> (pass * WRM_SORT_RADIX_BITS)) & (WRM_SORT_BUCKETS - 1)]++;
+        }
+    }
+
+    wrm_Sort_Key *src = keys;
+    wrm_Sort_Key *dest = tmp;
+    for(u32 pass = 0; pass < WRM_SORT_PASSES; pass++) {
+        u32 shift = pass * WRM_SORT_RADIX_BITS;
+        size_t *count = counts[pass];
+
+        // every key has the same digit here, so this pass would not move anything
+        if(count[(src[0].key >> shift) & (WRM_SORT_BUCKETS - 1)] == n) { continue; }
+
+        // turn the counts into the first position of each bucket
+        size_t pos = 0;
+        for(u32 b = 0; b < WRM_SORT_BUCKETS; b++) {
+            size_t c = count[b];
+            count[b] = pos;
+            pos += c;
+        }
+
+        for(size_t i = 0; i < n; i++) {
+            dest[count[(src[i].key >> shift) & (WRM_SORT_BUCKETS - 1)]++] = src[i];
+        }
+
+        wrm_Sort_Key *swap = src;
+        src = dest;
+        dest = swap;
+    }
+
+    if(src != keys) { memcpy(keys, src, n * sizeof(wrm_Sort_Key)); }
+}
@@ -1,26 +1,56 @@
 #include "wrm/memory.h"
 
-bool wrm_Stack_init(wrm_Stack *s, size_t capacity, size_t element_size, bool auto_reserve)
+bool wrm_Stack_init(wrm_Stack *s, size_t capacity, size_t element_size, bool auto_reserve, const wrm_Allocator *allocator)
 {
     if(!s) return false;
 
     s->len = 0;
     s->cap = capacity;
+    s->max_cap = 0;
     s->e_size = element_size;
-    s->data = calloc(capacity, element_size);
+    s->allocator = allocator;
+    s->data = wrm_alloc(allocator, capacity * element_size);
 
     s->auto_reserve = auto_reserve;
+    s->peak = 0;
+    s->realloc_cnt = 0;
+    s->realloc_bytes = 0;
     return s->data;
 }
 
+bool wrm_Stack_initVirtual(wrm_Stack *s, size_t capacity, size_t max_capacity, size_t element_size)
+{
+    if(!s || capacity > max_capacity) return false;
+
+    s->len = 0;
+    s->cap = capacity;
+    s->max_cap = max_capacity;
+    s->e_size = element_size;
+    s->allocator = NULL;
+    s->data = wrm_virtualReserve(max_capacity * element_size);
+
+    s->auto_reserve = true;
+    s->peak = 0;
+    s->realloc_cnt = 0;
+    s->realloc_bytes = 0;
+    return wrm_virtualCommit(s->data, capacity * element_size);
+}
+
 bool wrm_Stack_reserve(wrm_Stack *s, size_t capacity)
 {
     if(!s || capacity < s->cap) return false;
 
-    void *temp = realloc(s->data, capacity * s->e_size);
-    if(!temp) { return false; }
-    s->data = temp;
+    if(s->max_cap) { // virtual stacks: commit more of the reserved range in place
+        if(capacity > s->max_cap || !wrm_virtualCommit(s->data, capacity * s->e_size)) { return false; }
+    }
+    else {
+        void *temp = wrm_realloc(s->allocator, s->data, s->cap * s->e_size, capacity * s->e_size);
+        if(!temp) { return false; }
+        s->data = temp;
+        s->realloc_bytes += s->cap * s->e_size;
+    }
     s->cap = capacity;
+    s->realloc_cnt++;
     return true;
 }
 
@@ -28,10 +58,17 @@ bool wrm_Stack_shrink(wrm_Stack *s, size_t capacity)
 {
     if(!s || capacity > s->cap || capacity < s->len) return false;
 
-    void *temp = realloc(s->data, capacity * s->e_size);
-    if(!temp) { return false; }
-    s->data = temp;
+    if(s->max_cap) { // virtual stacks: give the unused tail pages back
+        wrm_virtualDecommit(s->data, capacity * s->e_size, s->cap * s->e_size);
+    }
+    else {
+        void *temp = wrm_realloc(s->allocator, s->data, s->cap * s->e_size, capacity * s->e_size);
+        if(!temp) { return false; }
+        s->data = temp;
+        s->realloc_bytes += capacity * s->e_size;
+    }
     s->cap = capacity;
+    s->realloc_cnt++;
     return true;
 }
 
@@ -39,10 +76,13 @@ wrm_Option_Handle wrm_Stack_push(wrm_Stack *s)
 {
     if(!s) return OPTION_NONE(Handle);
     if(s->len == s->cap) {
-        if(!(s->auto_reserve && wrm_Stack_reserve(s, s->cap * WRM_MEMORY_GROWTH_FACTOR))) { 
+        size_t new_cap = s->cap ? s->cap * WRM_MEMORY_GROWTH_FACTOR : 1;
+        if(s->max_cap && new_cap > s->max_cap) { new_cap = s->max_cap; }
+        if(!(s->auto_reserve && new_cap > s->cap && wrm_Stack_reserve(s, new_cap))) { 
             return OPTION_NONE(Handle);
         }
     }
+    if(s->len + 1 > s->peak) { s->peak = s->len + 1; }
     return OPTION_SOME(Handle, s->len++);
 }
 
@@ -56,15 +96,54 @@ void wrm_Stack_delete(wrm_Stack *s, void (*delete)(void *element))
         }
     }
     
-    free(s->data);
+    wrm_memoryUntrack(s);
+    if(s->max_cap) { wrm_virtualRelease(s->data, s->max_cap * s->e_size); }
+    else { wrm_free(s->allocator, s->data, s->cap * s->e_size); }
     s->data = NULL;
     s->e_size = 0;
     s->cap = 0;
+    s->max_cap = 0;
     s->len = 0;
 }
 
+bool wrm_Stack_snapshot(wrm_Stack *s, wrm_Stack_Snapshot *snap)
+{
+    if(!s || !snap) { return false; }
+
+    size_t size = s->len * s->e_size;
+    if(!snap->data || snap->size < size || snap->allocator != s->allocator) {
+        wrm_Stack_Snapshot_delete(snap);
+        snap->data = wrm_alloc(s->allocator, size ? size : 1);
+        if(!snap->data) { return false; }
+        snap->size = size ? size : 1;
+        snap->allocator = s->allocator;
+    }
+
+    memcpy(snap->data, s->data, size);
+    snap->len = s->len;
+    return true;
+}
+
+bool wrm_Stack_restore(wrm_Stack *s, const wrm_Stack_Snapshot *snap)
+{
+    if(!s || !snap || !snap->data) { return false; }
+    if(snap->len > s->cap && !wrm_Stack_reserve(s, snap->len)) { return false; }
+
+    memcpy(s->data, snap->data, snap->len * s->e_size);
+    s->len = snap->len;
+    return true;
+}
+
+void wrm_Stack_Snapshot_delete(wrm_Stack_Snapshot *snap)
+{
+    if(!snap) { return; }
+
+    wrm_free(snap->allocator, snap->data, snap->size);
+    *snap = (wrm_Stack_Snapshot){ 0 };
+}
+
 // force the compiler to emit a symbol
 
 void wrm_Stack_reset(wrm_Stack *s, size_t len);
 void *wrm_Stack_offsetAt(wrm_Stack *s, wrm_Handle idx, size_t offset);
-void *wrm_Stack_at(wrm_Stack *s, wrm_Handle idx);
\ No newline at end of file
+void *wrm_Stack_at(wrm_Stack *s, wrm_Handle idx);
@@ -0,0 +1,170 @@
+#include "wrm/memory.h"
+
+// a container tracked for statistics
+typedef struct wrm_Memory_Tracked {
+    const char *name;
+    wrm_Memory_Kind kind;
+    const void *container;
+    size_t expected; // live elements it may still hold at shutdown without leaking
+} wrm_Memory_Tracked;
+
+static wrm_Memory_Tracked wrm_memory_tracked[WRM_MEMORY_MAX_TRACKED];
+static u32 wrm_memory_tracked_cnt;
+
+// file-internal helper declarations
+static wrm_Memory_Tracked *wrm_memoryFind(const void *container);
+static const char *wrm_memoryKindName(wrm_Memory_Kind kind);
+
+bool wrm_memoryTrack(const char *name, wrm_Memory_Kind kind, const void *container)
+{
+    if(!container) { return false; }
+
+    wrm_Memory_Tracked *t = wrm_memoryFind(container);
+    if(!t) {
+        if(wrm_memory_tracked_cnt == WRM_MEMORY_MAX_TRACKED) { return false; }
+        t = &wrm_memory_tracked[wrm_memory_tracked_cnt++];
+    }
+
+    *t = (wrm_Memory_Tracked){ .name = name, .kind = kind, .container = container };
+    return true;
+}
+
+void wrm_memoryUntrack(const void *container)
+{
+    wrm_Memory_Tracked *t = wrm_memoryFind(container);
+    if(!t) { return; }
+
+    // keep the registry in tracking order for the dump
+    size_t after = (size_t)(wrm_memory_tracked + --wrm_memory_tracked_cnt - t);
+    memmove(t, t + 1, after * sizeof(wrm_Memory_Tracked));
+}
+
+void wrm_memoryExpect(const void *container)
+{
+    wrm_Memory_Tracked *t = wrm_memoryFind(container);
+    if(t) { t->expected = wrm_memoryStats(t->kind, container).len; }
+}
+
+wrm_Memory_Stats wrm_memoryStats(wrm_Memory_Kind kind, const void *container)
+{
+    wrm_Memory_Stats stats = { .kind = kind };
+    if(!container) { return stats; }
+
+    wrm_Memory_Tracked *t = wrm_memoryFind(container);
+    stats.name = t ? t->name : NULL;
+
+    switch(kind) {
+        case WRM_MEMORY_POOL: {
+            const wrm_Pool *p = container;
+            stats.e_size = p->e_size;
+            stats.cap = p->cap;
+            stats.len = p->used_cnt;
+            stats.peak = p->peak;
+            stats.realloc_cnt = p->realloc_cnt;
+            stats.realloc_bytes = p->realloc_bytes;
+            break;
+        }
+        case WRM_MEMORY_STACK: {
+            const wrm_Stack *s = container;
+            stats.e_size = s->e_size;
+            stats.cap = s->cap;
+            stats.len = s->len;
+            stats.peak = s->peak;
+            stats.realloc_cnt = s->realloc_cnt;
+            stats.realloc_bytes = s->realloc_bytes;
+            break;
+        }
+        case WRM_MEMORY_ARENA: {
+            const wrm_Arena *a = container;
+            stats.e_size = 1;
+            stats.cap = a->cap;
+            stats.len = a->pos;
+            stats.peak = a->peak;
+            stats.realloc_cnt = a->commit_cnt;
+            break;
+        }
+        case WRM_MEMORY_FRAME_ARENA: {
+            // both arenas together: the current frame's use, and the worst frame of either
+            const wrm_Frame_Arena *fa = container;
+            const wrm_Arena *curr = &fa->arenas[fa->curr];
+            const wrm_Arena *prev = &fa->arenas[fa->curr ^ 1];
+            stats.e_size = 1;
+            stats.cap = curr->cap + prev->cap;
+            stats.len = curr->pos;
+            stats.peak = curr->peak > prev->peak ? curr->peak : prev->peak;
+            stats.realloc_cnt = curr->commit_cnt + prev->commit_cnt;
+            break;
+        }
+    }
+    return stats;
+}
+
+void wrm_memoryDump(FILE *f, bool json)
+{
+    if(!f) { return; }
+
+    if(json) { fprintf(f, "["); }
+    else {
+        fprintf(f, "%-24s %-12s %8s %10s %10s %10s %12s %8s %14s\n",
+            "NAME", "KIND", "ELEMENT", "CAPACITY", "LIVE", "PEAK", "BYTES", "RESIZES", "BYTES MOVED"
+        );
+    }
+
+    for(u32 i = 0; i < wrm_memory_tracked_cnt; i++) {
+        wrm_Memory_Tracked *t = &wrm_memory_tracked[i];
+        wrm_Memory_Stats s = wrm_memoryStats(t->kind, t->container);
+
+        if(json) {
+            fprintf(f,
+                "%s\n  {\"name\": \"%s\", \"kind\": \"%s\", \"element_size\": %zu, \"capacity\": %zu, \"live\": %zu, "
+                "\"peak\": %zu, \"bytes\": %zu, \"resizes\": %zu, \"bytes_moved\": %zu}",
+                i ? "," : "", s.name ? s.name : "", wrm_memoryKindName(s.kind), s.e_size, s.cap, s.len,
+                s.peak, s.cap * s.e_size, s.realloc_cnt, s.realloc_bytes
+            );
+        }
+        else {
+            fprintf(f, "%-24s %-12s %8zu %10zu %10zu %10zu %12zu %8zu %14zu\n",
+                s.name ? s.name : "", wrm_memoryKindName(s.kind), s.e_size, s.cap, s.len,
+                s.peak, s.cap * s.e_size, s.realloc_cnt, s.realloc_bytes
+            );
+        }
+    }
+
+    if(json) { fprintf(f, "%s]\n", wrm_memory_tracked_cnt ? "\n" : ""); }
+}
+
+size_t wrm_memoryReportLeaks(const void *container)
+{
+    wrm_Memory_Tracked *t = wrm_memoryFind(container);
+    if(!t) { return 0; }
+
+    wrm_Memory_Stats s = wrm_memoryStats(t->kind, container);
+    if(s.len <= t->expected) { return 0; }
+
+    size_t leaked = s.len - t->expected;
+    wrm_error("Memory", "reportLeaks()", "'%s' still holds %zu %s (%zu bytes) at shutdown",
+        s.name ? s.name : "?", leaked, leaked == 1 ? "element" : "elements", leaked * s.e_size
+    );
+    return leaked;
+}
+
+// file-internal helpers
+
+static wrm_Memory_Tracked *wrm_memoryFind(const void *container)
+{
+    for(u32 i = 0; i < wrm_memory_tracked_cnt; i++) {
+        if(wrm_memory_tracked[i].container == container) { return &wrm_memory_tracked[i]; }
+    }
+    return NULL;
+}
+
+static const char *wrm_memoryKindName(wrm_Memory_Kind kind)
+{
+    switch(kind) {
+        case WRM_MEMORY_POOL: return "pool";
+        case WRM_MEMORY_STACK: return "stack";
+        case WRM_MEMORY_ARENA: return "arena";
+        case WRM_MEMORY_FRAME_ARENA: return "frame arena";
+    }
+    return "?";
+}
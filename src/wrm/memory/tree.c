@@ -1,41 +1,150 @@
 #include "wrm/memory.h"
 
-
-bool wrm_Tree_init(wrm_Tree *tree, wrm_Pool *src, size_t offset, size_t child_limit, bool auto_reserve)
+// file-internal helper declarations
+static void wrm_Tree_remapNodes(void *ctx, const u32 *remap, size_t len);
+static bool wrm_Tree_reserveFlat(wrm_Tree *tree, size_t capacity);
+static bool wrm_Tree_flattenFrom(wrm_Tree *tree, u32 root);
+static bool wrm_Tree_Iter_push(wrm_Tree_Iter *it, u32 node);
+static bool wrm_Tree_Iter_descendLeft(wrm_Tree_Iter *it);
+
+bool wrm_Tree_init(wrm_Tree *tree, wrm_Pool *src, size_t offset)
 {
     if(!tree || !src) { return false; }
 
-    tree->src = src;
-    tree->child_limit = child_limit;
-    tree->offset = offset;
+    *tree = (wrm_Tree){ .src = src, .offset = offset };
+
+    // keep links valid when the source pool is compacted
+    return wrm_Pool_addRemapHook(src, wrm_Tree_remapNodes, tree);
+}
+
+bool wrm_Tree_initFlat(wrm_Tree *tree, wrm_Pool *src, size_t offset, const wrm_Allocator *allocator)
+{
+    if(!wrm_Tree_init(tree, src, offset)) { return false; }
+
+    // the arrays are allocated by the first flatten
+    tree->allocator = allocator;
+    tree->flat = true;
+    tree->stale = true;
+    return true;
+}
+
+bool wrm_Tree_flatten(wrm_Tree *tree)
+{
+    if(!tree || !tree->src || !tree->flat) { return false; }
+    if(!tree->stale) { return true; }
 
-    if(!wrm_Pool_init(&tree->child_lists, src->cap, child_limit * sizeof(u32), auto_reserve)) {
+    wrm_Pool *src = tree->src;
+    if(src->used_cnt > tree->flat_cap && !wrm_Tree_reserveFlat(tree, src->cap)) {
         return false;
-    } 
+    }
+
+    // nodes whose parent was freed without detaching them are unreachable, and left out
+    tree->flat_len = 0;
+    wrm_Pool_FOR_EACH(src, i) {
+        if(!wrm_Tree_peek(tree, i)->has_parent && !wrm_Tree_flattenFrom(tree, i)) {
+            tree->flat_len = 0;
+            return false;
+        }
+    }
 
+    tree->stale = false;
     return true;
 }
 
+void wrm_Tree_Iter_init(wrm_Tree_Iter *it, wrm_Tree *tree, u32 root, bool post, wrm_Arena *arena)
+{
+    if(!it) { return; }
+    *it = (wrm_Tree_Iter){ .tree = tree, .arena = arena, .root = root, .post = post };
+}
+
+wrm_Option_Handle wrm_Tree_Iter_next(wrm_Tree_Iter *it)
+{
+    if(!it || !it->tree || it->done) { return OPTION_NONE(Handle); }
+    wrm_Tree *tree = it->tree;
+
+    if(!it->started) {
+        it->started = true;
+        it->node = it->root;
+        it->done = !wrm_Tree_peek(tree, it->root) || (it->post && !wrm_Tree_Iter_descendLeft(it));
+        it->descend = !it->post;
+        return it->done ? OPTION_NONE(Handle) : OPTION_SOME(Handle, it->node);
+    }
+
+    const wrm_Tree_Node *n = wrm_Tree_peek(tree, it->node);
+    if(!it->post && it->descend && n->child_cnt) {
+        if(!wrm_Tree_Iter_push(it, it->node)) {
+            it->done = true;
+            return OPTION_NONE(Handle);
+        }
+        it->node = n->first_child;
+        return OPTION_SOME(Handle, it->node);
+    }
+
+    // move on to the next sibling, climbing out of finished subtrees
+    while(it->depth) {
+        u32 parent = it->path[it->depth - 1];
+
+        if(it->node != wrm_Tree_peek(tree, parent)->last_child) {
+            it->node = wrm_Tree_peek(tree, it->node)->next_sibling;
+            it->descend = true;
+            if(it->post && !wrm_Tree_Iter_descendLeft(it)) { break; }
+            return OPTION_SOME(Handle, it->node);
+        }
+
+        it->depth--;
+        it->node = parent;
+        if(it->post) { return OPTION_SOME(Handle, parent); } // all of its children are done
+    }
+
+    it->done = true;
+    return OPTION_NONE(Handle);
+}
+
+bool wrm_Tree_visit(wrm_Tree *tree, u32 root, wrm_Arena *arena, wrm_FUNC(enter, bool, void *ctx, u32 node, u32 depth), wrm_FUNC(leave, void, void *ctx, u32 node, u32 depth), void *ctx)
+{
+    if(!tree || !enter || !wrm_Tree_peek(tree, root)) { return false; }
+
+    // only the iterator's path is used
+    wrm_Tree_Iter it;
+    wrm_Tree_Iter_init(&it, tree, root, false, arena);
+    u32 node = root;
+
+    while(true) {
+        const wrm_Tree_Node *n = wrm_Tree_peek(tree, node);
+        if(enter(ctx, node, it.depth) && n->child_cnt) {
+            if(!wrm_Tree_Iter_push(&it, node)) { return false; }
+            node = n->first_child;
+            continue;
+        }
+
+        // leave finished nodes until one has a sibling left to enter
+        while(true) {
+            if(leave) { leave(ctx, node, it.depth); }
+            if(!it.depth) { return true; }
+
+            u32 parent = it.path[it.depth - 1];
+            if(node != wrm_Tree_peek(tree, parent)->last_child) {
+                node = wrm_Tree_peek(tree, node)->next_sibling;
+                break;
+            }
+            it.depth--;
+            node = parent;
+        }
+    }
+}
+
 bool wrm_Tree_hasChild(wrm_Tree *tree, u32 parent, u32 child)
 {
     if(!tree) { return false; }
-    wrm_Tree_Node *p = wrm_Tree_at(tree, parent);
-    wrm_Tree_Node *c = wrm_Tree_at(tree, child);
+    const wrm_Tree_Node *p = wrm_Tree_peek(tree, parent);
+    const wrm_Tree_Node *c = wrm_Tree_peek(tree, child);
     
     // ensure parent and child exist in src
     if(!p || !c) {
         return false;
     }
 
-    if(p->child_cnt == 0) { return false; }
-    if(p->child_cnt == 1) { return p->children == child; }
-    u32 *children = wrm_Pool_at(&tree->child_lists, p->children);
-
-    for(u8 i = 0; i < p->child_cnt; i++) {
-        if(children[i] == child) { return true; }
-    }
-    
-    return false;
+    return c->has_parent && c->parent == parent;
 }
 
 bool wrm_Tree_makeRoot(wrm_Tree *tree, u32 node)
@@ -46,10 +155,25 @@ bool wrm_Tree_makeRoot(wrm_Tree *tree, u32 node)
 
     // if n has a parent, orphan it
 
-    if(n->has_parent && wrm_Tree_hasChild(tree, n->parent, node)) {
+    if(n->has_parent && wrm_Tree_peek(tree, n->parent)) {
         return wrm_Tree_removeChild(tree, n->parent, node);
     }
     n->has_parent = false;
+    tree->stale = true;
+    return true;
+}
+
+bool wrm_Tree_detach(wrm_Tree *tree, u32 node)
+{
+    if(!wrm_Tree_makeRoot(tree, node)) { return false; }
+    wrm_Tree_Node *n = wrm_Tree_at(tree, node);
+
+    // the children's sibling links are meaningless once they are roots, so only the flag changes
+    wrm_Tree_FOR_EACH_CHILD(tree, n, c) {
+        wrm_Tree_at(tree, c)->has_parent = false;
+    }
+    n->child_cnt = 0;
+    tree->stale = true;
     return true;
 }
 
@@ -60,44 +184,35 @@ bool wrm_Tree_addChild(wrm_Tree *tree, u32 parent, u32 child)
     wrm_Tree_Node *c = wrm_Tree_at(tree, child);
 
     // ensure parent and child exist in src
-    if(!p || !c) {
+    if(!p || !c || parent == child) {
         return false;
     }
 
     if(c->has_parent) { // if child tree node already has a parent, must dissociate those properly first
         return false;
     }
-    // ensure parent does not already have child and has room for it
-    if(p->child_cnt == tree->child_limit || wrm_Tree_hasChild(tree, parent, child)) {
-        return false;
+#ifdef WRM_TREE_CHECK_CYCLES
+    // ensure child is not an ancestor of parent, which would form a cycle
+    for(const wrm_Tree_Node *a = p; a && a->has_parent; a = wrm_Tree_peek(tree, a->parent)) {
+        if(a->parent == child) { return false; }
     }
-
+#endif
 
     c->parent = parent;
     c->has_parent = true;
 
+    // append after the current last child
     if(p->child_cnt == 0) {
-        p->child_cnt++;
-        p->children = child;
-        return true;
-    }
-
-    u32 *children;
-
-    if(p->child_cnt == 1) {
-        wrm_Option_Handle result = wrm_Pool_getSlot(&tree->child_lists);
-        if(!result.exists) { return false; }
-        u32 tmp = p->children;
-        p->children = result.val;
-
-        children = wrm_Pool_at(&tree->child_lists, p->children);
-        children[0] = tmp;
+        p->first_child = child;
     }
     else {
-        children = wrm_Pool_at(&tree->child_lists, p->children);
+        wrm_Tree_at(tree, p->last_child)->next_sibling = child;
+        c->prev_sibling = p->last_child;
     }
+    p->last_child = child;
+    p->child_cnt++;
 
-    children[p->child_cnt++] = child;
+    tree->stale = true;
     return true;
 }
 
@@ -112,46 +227,32 @@ bool wrm_Tree_removeChild(wrm_Tree *tree, u32 parent, u32 child)
         return false;
     }
 
-    if(p->child_cnt == 0) {
-        return false; // cannot remove if no children
-    }
-
     // cannot remove if child and parent are not already associated
-    if(!wrm_Tree_hasChild(tree, parent, child) || !c->has_parent) {
+    if(p->child_cnt == 0 || !c->has_parent || c->parent != parent) {
         return false; 
     }
-    
-    if(p->child_cnt == 1) {
-        p->child_cnt = 0;  
-        c->has_parent = false;  
-        return true;
-    }
 
-    u32 *children = wrm_Pool_at(&tree->child_lists, p->children);
+    // unlink from the siblings, moving the parent's ends if the child was at one
+    bool is_first = p->first_child == child;
+    bool is_last = p->last_child == child;
 
-    // find the child
-    u8 idx;
-    for(idx = 0; idx < p->child_cnt; idx++) {
-        if(children[idx] == child) break;
+    if(is_first && !is_last) {
+        p->first_child = c->next_sibling;
     }
-    if(idx == tree->child_limit) {
-        return false; // could not find child
+    else if(!is_first) {
+        wrm_Tree_at(tree, c->prev_sibling)->next_sibling = c->next_sibling;
     }
 
-    // dissociate, shift child list data over
-    p->child_cnt--;
-    c->has_parent = false;
-    while(idx < p->child_cnt) {
-        children[idx] = children[idx + 1];
-        idx++;
+    if(is_last && !is_first) {
+        p->last_child = c->prev_sibling;
     }
-
-    // free list if we only have one child
-    if(p->child_cnt == 1) {
-        wrm_Pool_freeSlot(&tree->child_lists, p->children);
-        p->children = children[0];
+    else if(!is_last) {
+        wrm_Tree_at(tree, c->next_sibling)->prev_sibling = c->prev_sibling;
     }
-    
+
+    p->child_cnt--;
+    c->has_parent = false;
+    tree->stale = true;
     return true;
 }
 
@@ -159,10 +260,62 @@ void wrm_Tree_delete(wrm_Tree *tree)
 {
     if(!tree || !tree->src ) { return; }
     
-    wrm_Pool_delete(&tree->child_lists, NULL); // no special cleanup needed
-    tree->src = NULL;
-    tree->child_limit = 0;
-    tree->offset = 0;
+    wrm_Pool_removeRemaps(tree->src, tree);
+    if(tree->order) {
+        wrm_free(tree->allocator, tree->order, 3 * tree->flat_cap * sizeof(u32));
+    }
+    *tree = (wrm_Tree){ 0 };
+}
+
+bool wrm_Tree_snapshot(wrm_Tree *tree, wrm_Tree_Snapshot *snap)
+{
+    if(!tree || !snap) { return false; }
+
+    // stale arrays are rebuilt after a restore anyway, so only current ones are worth copying
+    bool stale = tree->stale || !tree->order;
+    size_t len = stale ? 0 : tree->flat_len;
+
+    if(len && (snap->flat_cap < len || snap->allocator != tree->allocator)) {
+        wrm_Tree_Snapshot_delete(snap);
+        snap->order = wrm_alloc(tree->allocator, 3 * len * sizeof(u32));
+        if(!snap->order) { return false; }
+        snap->flat_cap = len;
+        snap->allocator = tree->allocator;
+    }
+    snap->stale = stale;
+    snap->flat_len = len;
+    if(!len) { return true; }
+
+    memcpy(snap->order, tree->order, snap->flat_len * sizeof(u32));
+    memcpy(snap->order + snap->flat_cap, tree->parent_pos, snap->flat_len * sizeof(u32));
+    memcpy(snap->order + 2 * snap->flat_cap, tree->subtree_len, snap->flat_len * sizeof(u32));
+    return true;
+}
+
+bool wrm_Tree_restore(wrm_Tree *tree, const wrm_Tree_Snapshot *snap)
+{
+    if(!tree || !snap) { return false; }
+
+    if(snap->stale || !tree->flat) {
+        tree->stale = true;
+        return true;
+    }
+    if(snap->flat_len > tree->flat_cap && !wrm_Tree_reserveFlat(tree, snap->flat_len)) { return false; }
+
+    memcpy(tree->order, snap->order, snap->flat_len * sizeof(u32));
+    memcpy(tree->parent_pos, snap->order + snap->flat_cap, snap->flat_len * sizeof(u32));
+    memcpy(tree->subtree_len, snap->order + 2 * snap->flat_cap, snap->flat_len * sizeof(u32));
+    tree->flat_len = snap->flat_len;
+    tree->stale = false;
+    return true;
+}
+
+void wrm_Tree_Snapshot_delete(wrm_Tree_Snapshot *snap)
+{
+    if(!snap) { return; }
+
+    wrm_free(snap->allocator, snap->order, 3 * snap->flat_cap * sizeof(u32));
+    *snap = (wrm_Tree_Snapshot){ 0 };
 }
 
 void wrm_Tree_debugNode(wrm_Tree_Node *tn, wrm_Tree *tree) {
@@ -174,20 +327,132 @@ void wrm_Tree_debugNode(wrm_Tree_Node *tn, wrm_Tree *tree) {
     }
     printf("child_count: %u", tn->child_cnt);
     if(tn->child_cnt > 0) {
-       printf(", children: %u", tn->children);
-    }
-    if(tn->child_cnt > 1) {
-        u32 *children = wrm_Pool_at(&tree->child_lists, tn->children);
-        printf("{ ");
-        for(u8 i = 0; i < tn->child_cnt; i++) {
-            printf("%u ", children[i]);
+        printf(", children: { ");
+        wrm_Tree_FOR_EACH_CHILD(tree, tn, c) {
+            printf("%u ", c);
         }
         printf("}");
     }
     printf(" }");
 }
 
+// file-internal helpers
+
+/* Rewrite every link after the tree's source pool was compacted */
+static void wrm_Tree_remapNodes(void *ctx, const u32 *remap, size_t len)
+{
+    wrm_Tree *tree = ctx;
+
+    // links that are not in use may hold anything, so only map those in range
+    #define WRM_TREE_REMAP(link) if((link) < len) { (link) = remap[(link)]; }
+
+    wrm_Pool_FOR_EACH(tree->src, i) {
+        wrm_Tree_Node *n = wrm_Tree_at(tree, i);
+        WRM_TREE_REMAP(n->parent);
+        WRM_TREE_REMAP(n->first_child);
+        WRM_TREE_REMAP(n->last_child);
+        WRM_TREE_REMAP(n->next_sibling);
+        WRM_TREE_REMAP(n->prev_sibling);
+    }
+
+    #undef WRM_TREE_REMAP
+
+    // positions do not change, so a current layout only needs its slots renamed
+    for(size_t pos = 0; pos < tree->flat_len; pos++) {
+        tree->order[pos] = remap[tree->order[pos]];
+    }
+}
+
+/* Give the flattened arrays room for `capacity` nodes, as one block; the old contents are dropped */
+static bool wrm_Tree_reserveFlat(wrm_Tree *tree, size_t capacity)
+{
+    u32 *block = wrm_alloc(tree->allocator, 3 * capacity * sizeof(u32));
+    if(!block) { return false; }
+
+    if(tree->order) {
+        wrm_free(tree->allocator, tree->order, 3 * tree->flat_cap * sizeof(u32));
+    }
+    tree->order = block;
+    tree->parent_pos = block + capacity;
+    tree->subtree_len = block + 2 * capacity;
+    tree->flat_cap = capacity;
+    return true;
+}
+
+/*
+Append the subtree under `root` to the flattened arrays in pre-order
+Walks the links without a stack: down through first children, then across
+to the next sibling or back up through the parent positions already written
+*/
+static bool wrm_Tree_flattenFrom(wrm_Tree *tree, u32 root)
+{
+    u32 node = root;
+    u32 up = WRM_POOL_NO_SLOT; // position of the parent of `node`
+
+    while(true) {
+        const wrm_Tree_Node *n = wrm_Tree_peek(tree, node);
+        // a dangling link, or more nodes than the pool holds (a cycle)
+        if(!n || tree->flat_len == tree->src->used_cnt) { return false; }
+
+        u32 pos = (u32)tree->flat_len++;
+        tree->order[pos] = node;
+        tree->parent_pos[pos] = up;
+
+        if(n->child_cnt) {
+            up = pos;
+            node = n->first_child;
+            continue;
+        }
+
+        // close finished subtrees until one has a sibling left to visit
+        tree->subtree_len[pos] = 1;
+        while(true) {
+            up = tree->parent_pos[pos];
+            if(up == WRM_POOL_NO_SLOT) { return true; }
+
+            if(tree->order[pos] != wrm_Tree_peek(tree, tree->order[up])->last_child) {
+                node = wrm_Tree_peek(tree, tree->order[pos])->next_sibling;
+                break;
+            }
+            pos = up;
+            tree->subtree_len[pos] = (u32)(tree->flat_len - pos);
+        }
+    }
+}
+
+/* Push `node` onto the iterator's path, moving the path to a bigger block of the arena when it is full */
+static bool wrm_Tree_Iter_push(wrm_Tree_Iter *it, u32 node)
+{
+    if(it->depth == it->path_cap) {
+        u32 cap = it->path_cap ? 2 * it->path_cap : 32;
+        u32 *path = it->arena ? wrm_Arena_PUSH(it->arena, u32, cap) : NULL;
+        if(!path) {
+            it->overflow = true;
+            return false;
+        }
+        if(it->depth) { memcpy(path, it->path, it->depth * sizeof(u32)); }
+        it->path = path;
+        it->path_cap = cap;
+    }
+
+    it->path[it->depth++] = node;
+    return true;
+}
+
+/* Post-order: go down through first children from `node` to the first node to visit */
+static bool wrm_Tree_Iter_descendLeft(wrm_Tree_Iter *it)
+{
+    for(const wrm_Tree_Node *n = wrm_Tree_peek(it->tree, it->node); n->child_cnt; n = wrm_Tree_peek(it->tree, it->node)) {
+        if(!wrm_Tree_Iter_push(it, it->node)) { return false; }
+        it->node = n->first_child;
+    }
+    return true;
+}
+
 // ensure compiler emits symbol
 
-wrm_Tree_Node *wrm_Tree_at(wrm_Tree *tree, u32 idx);
+void wrm_Tree_Iter_skipChildren(wrm_Tree_Iter *it);
 
+void wrm_Tree_invalidate(wrm_Tree *tree);
+wrm_Tree_Node *wrm_Tree_at(wrm_Tree *tree, u32 idx);
+const wrm_Tree_Node *wrm_Tree_peek(wrm_Tree *tree, wrm_Handle idx);
@@ -0,0 +1,47 @@
+#define _DEFAULT_SOURCE // MAP_ANONYMOUS, MAP_NORESERVE and madvise() under -std=c11
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "wrm/memory.h"
+
+size_t wrm_pageSize(void)
+{
+    static size_t page_size = 0;
+    if(!page_size) { page_size = (size_t)sysconf(_SC_PAGESIZE); }
+    return page_size;
+}
+
+void *wrm_virtualReserve(size_t bytes)
+{
+    if(!bytes) { return NULL; }
+    void *addr = mmap(NULL, wrm_pageRound(bytes), PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return addr == MAP_FAILED ? NULL : addr;
+}
+
+bool wrm_virtualCommit(void *base, size_t bytes)
+{
+    if(!base) { return false; }
+    if(!bytes) { return true; }
+    return mprotect(base, wrm_pageRound(bytes), PROT_READ | PROT_WRITE) == 0;
+}
+
+void wrm_virtualDecommit(void *base, size_t from, size_t to)
+{
+    from = wrm_pageRound(from);
+    to = wrm_pageRound(to);
+    if(!base || from >= to) { return; }
+
+    // give the physical pages back; they read as zero if committed again
+    madvise((u8*)base + from, to - from, MADV_DONTNEED);
+    mprotect((u8*)base + from, to - from, PROT_NONE);
+}
+
+void wrm_virtualRelease(void *base, size_t bytes)
+{
+    if(!base || !bytes) { return; }
+    munmap(base, wrm_pageRound(bytes));
+}
+
+// force the compiler to emit a symbol
+
+size_t wrm_pageRound(size_t bytes);
@@ -5,6 +5,9 @@
 static const u8 floats_per_col = 4;
 static const u8 floats_per_uv = 2;
 
+// file-internal helper declarations
+static void wrm_render_computeBounds(wrm_Mesh *mesh, const wrm_Mesh_Data *data);
+
 // default meshes
 
 // equilateral triangle centered at origin facing +x; colors: top = red, lower-right = green, lower-left = blue
@@ -214,6 +217,7 @@ wrm_Option_Handle wrm_render_createMesh(const wrm_Mesh_Data *data)
         &mesh->pos_vbo, WRM_SHADER_ATTRIB_POS_LOC, data->vtx_cnt, 
         mesh->format.per_pos, data->positions, gl_draw
     );
+    wrm_render_computeBounds(mesh, data);
     
     
     if(mesh->format.col) {
@@ -270,6 +274,7 @@ wrm_Option_Handle wrm_render_cloneMesh(wrm_Handle mesh)
 bool wrm_render_updateMesh(wrm_Handle mesh, const wrm_Mesh_Data *data)
 {
     // TODO: look up how to update GPU buffers
+    // once positions are uploaded here, refit the bounds with them, or culling follows the wrong shape
     return true;
 }
 
@@ -314,4 +319,37 @@ void wrm_Mesh_delete(void *mesh)
     // silently ignores any of these that are 0
     glDeleteBuffers(4, (GLuint[]){ m->pos_vbo, m->col_vbo, m->uv_vbo, m->ebo});
     glDeleteVertexArrays(1, &m->vao);
-}
\ No newline at end of file
+}
+
+// file-internal helpers
+
+/* Fit an axis-aligned box and a sphere around the positions of `data`, laid out by its own format; 2D positions lie at z = 0 */
+static void wrm_render_computeBounds(wrm_Mesh *mesh, const wrm_Mesh_Data *data)
+{
+    u8 per_pos = data->format.per_pos;
+    glm_vec3_zero(mesh->aabb[0]);
+    glm_vec3_zero(mesh->aabb[1]);
+    glm_vec4_zero(mesh->sphere);
+    if(!data->vtx_cnt || per_pos < 2) { return; }
+
+    glm_vec3_fill(mesh->aabb[0], FLT_MAX);
+    glm_vec3_fill(mesh->aabb[1], -FLT_MAX);
+    for(size_t i = 0; i < data->vtx_cnt; i++) {
+        const float *p = data->positions + i * per_pos;
+        vec3 v = { p[0], p[1], per_pos > 2 ? p[2] : 0.0f };
+        glm_vec3_minv(mesh->aabb[0], v, mesh->aabb[0]);
+        glm_vec3_maxv(mesh->aabb[1], v, mesh->aabb[1]);
+    }
+
+    // centered on the box, but only as big as the furthest vertex: tighter than the box's corners
+    vec3 center;
+    glm_aabb_center(mesh->aabb, center);
+    float r2 = 0.0f;
+    for(size_t i = 0; i < data->vtx_cnt; i++) {
+        const float *p = data->positions + i * per_pos;
+        vec3 v = { p[0], p[1], per_pos > 2 ? p[2] : 0.0f };
+        float d2 = glm_vec3_distance2(center, v);
+        if(d2 > r2) { r2 = d2; }
+    }
+    glm_vec4(center, sqrtf(r2), mesh->sphere);
+}
@@ -37,13 +37,15 @@ wrm_Option_Handle wrm_render_createModel(const wrm_Model_Data *data, wrm_Handle
 
     wrm_Model* m = wrm_Pool_at(&wrm_models, result.val);
     m->tree_node = (wrm_Tree_Node){ 0 };
+    wrm_Tree_invalidate(&wrm_model_tree); // a new root
     m->shown = data->shown;
     m->children_shown = true;
 
+    // the shader is checked against the mesh, so the mesh must be set first
     bool update_success = 
-        wrm_render_setModelShader(model, shader) && 
         wrm_render_setModelMesh(model, data->mesh) && 
         wrm_render_setModelTexture(model, data->texture) &&
+        wrm_render_setModelShader(model, shader) && 
         wrm_render_setModelTransform(model, data->pos, data->rot, data->scale) &&
         (!parent || wrm_render_addChild(*parent, model));
 
@@ -60,7 +62,7 @@ bool wrm_render_getModel(wrm_Handle model, wrm_Model *dest)
     if(!wrm_render_exists(model, WRM_RENDER_RESOURCE_MODEL, "getModel()", "")) {
         return false;
     }
-    *dest = ((wrm_Model*)wrm_models.data)[model];
+    *dest = *(wrm_Model*)wrm_Pool_at(&wrm_models, model);
     return true;
 }
 
@@ -72,6 +74,7 @@ bool wrm_render_setModelTransform(wrm_Handle model, const vec3 pos, const vec3 r
     if(pos) wrm_vec3_copy(pos, data->pos);
     if(rot) wrm_vec3_copy(rot, data->rot);
     if(scale) wrm_vec3_copy(scale, data->scale);
+    data->transform_dirty = true;
 
     return true;
 }
@@ -84,6 +87,7 @@ bool wrm_render_addModelTransform(wrm_Handle model, const vec3 pos, const vec3 r
     if(pos) wrm_vec3_add(pos, data->pos);
     if(rot) wrm_vec3_add(rot, data->rot);
     if(scale) wrm_vec3_add(scale, data->scale);
+    data->transform_dirty = true;
 
     return true;
 }
@@ -91,21 +95,21 @@ bool wrm_render_addModelTransform(wrm_Handle model, const vec3 pos, const vec3 r
 bool wrm_render_setModelMesh(wrm_Handle model, wrm_Handle mesh) 
 {
     wrm_Model *m = wrm_Pool_at(&wrm_models, model);
-    wrm_Mesh *msh = wrm_Pool_at(&wrm_meshes, mesh);
-    if(!m || !msh) { return false; }
+    wrm_Option_Ref ref = wrm_Pool_getRef(&wrm_meshes, mesh);
+    if(!m || !ref.exists) { return false; }
 
-    m->mesh = mesh;
+    m->mesh = ref.val;
     return true;
 }
 
 bool wrm_render_setModelTexture(wrm_Handle model, wrm_Handle texture)
 {
     wrm_Model *m = wrm_Pool_at(&wrm_models, model);
-    wrm_Texture *t = wrm_Pool_at(&wrm_textures, texture);
+    wrm_Option_Ref ref = wrm_Pool_getRef(&wrm_textures, texture);
 
-    if(!m || !t) { return false; }
+    if(!m || !ref.exists) { return false; }
 
-    m->texture = texture;
+    m->texture = ref.val;
     return true;
 }
 
@@ -115,18 +119,18 @@ bool wrm_render_setModelShader(wrm_Handle model, wrm_Handle shader)
     wrm_Shader *s = wrm_Pool_at(&wrm_shaders, shader);
     if(!mod || !s) { return false; }
 
-    wrm_Mesh *mesh = wrm_Pool_at(&wrm_meshes, mod->mesh);
+    wrm_Mesh *mesh = wrm_Pool_deref(&wrm_meshes, mod->mesh);
     if(!mesh) { return false; }
 
     // ensure the shader and mesh are compatible
     wrm_render_Format sf = s->format;
     wrm_render_Format mf = mesh->format;
     if( (sf.col && !mf.col) || (sf.per_pos && !mf.per_pos) || (sf.tex && !mf.tex)) {
-        if(wrm_render_settings.errors) wrm_error("Render", "setModelShader()", "Mesh [%u] does not meet shader [%u] data requirements", mod->mesh, shader);
+        if(wrm_render_settings.errors) wrm_error("Render", "setModelShader()", "Mesh [%u] does not meet shader [%u] data requirements", mod->mesh.idx, shader);
         return false;
     }
 
-    mod->shader = shader;
+    mod->shader = wrm_Pool_getRef(&wrm_shaders, shader).val;
     return true;
 }
 
@@ -144,12 +148,21 @@ void wrm_render_setChildrenShown(wrm_Handle model, bool shown)
 
 bool wrm_render_addChild(wrm_Handle parent, wrm_Handle child)
 {
-    return wrm_Tree_addChild(&wrm_model_tree, parent, child);
+    if(!wrm_Tree_addChild(&wrm_model_tree, parent, child)) { return false; }
+
+    // the child's world transform now includes the parent's; its own children follow when it is recomputed
+    wrm_Model *m = wrm_Pool_at(&wrm_models, child);
+    m->transform_dirty = true;
+    return true;
 }
 
 bool wrm_render_removeChild(wrm_Handle parent, wrm_Handle child)
 {
-    return wrm_Tree_removeChild(&wrm_model_tree, parent, child);
+    if(!wrm_Tree_removeChild(&wrm_model_tree, parent, child)) { return false; }
+
+    wrm_Model *m = wrm_Pool_at(&wrm_models, child);
+    m->transform_dirty = true;
+    return true;
 }
 
 void wrm_render_debugModel(wrm_Handle model)
@@ -162,9 +175,9 @@ void wrm_render_debugModel(wrm_Handle model)
         "pos: < %.2f %.2f %.2f >, rot: < %.2f %.2f %.2f >, scale: < %.2f %.2f %.2f >, tree_node:"
         , 
         model, 
-        m->shader,
-        m->texture,
-        m->mesh,
+        m->shader.idx,
+        m->texture.idx,
+        m->mesh.idx,
         m->shown ? "true" : "false",
         m->children_shown ? "true" : "false",
         m->pos[0], m->pos[1], m->pos[2],
@@ -178,7 +191,17 @@ void wrm_render_debugModel(wrm_Handle model)
 
 void wrm_render_deleteModel(wrm_Handle model)
 {
-    wrm_Model_delete(wrm_Pool_at(&wrm_models, model));
+    wrm_Model *m = wrm_Pool_at(&wrm_models, model);
+    wrm_Model_delete(m);
+
+    // children are left as roots, so their world transforms lose this model's
+    if(m) {
+        wrm_Tree_FOR_EACH_CHILD(&wrm_model_tree, &m->tree_node, c) {
+            wrm_Model *child = wrm_Pool_at(&wrm_models, c);
+            child->transform_dirty = true;
+        }
+    }
+    wrm_Tree_detach(&wrm_model_tree, model);
     wrm_Pool_freeSlot(&wrm_models, model);
 }
 
@@ -246,7 +269,7 @@ void wrm_Model_delete(void *model)
     wrm_Model *m = model;
 
     // if any of these are non-NULL they will be cleaned up
-    wrm_Shader_delete(wrm_Pool_at(&wrm_shaders, m->shader));
-    wrm_Mesh_delete(wrm_Pool_at(&wrm_meshes, m->mesh));
-    wrm_Texture_delete(wrm_Pool_at(&wrm_textures, m->texture));
+    wrm_Shader_delete(wrm_Pool_deref(&wrm_shaders, m->shader));
+    wrm_Mesh_delete(wrm_Pool_deref(&wrm_meshes, m->mesh));
+    wrm_Texture_delete(wrm_Pool_deref(&wrm_textures, m->texture));
 }
\ No newline at end of file
@@ -1,5 +1,9 @@
 #include "render.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 /*
 File-internal types
 */
@@ -12,10 +16,33 @@ typedef struct wrm_render_Data {
     wrm_Handle shader;
     wrm_Handle texture;
     wrm_Handle src_model;
-    float distance;
     bool transparent;
 } wrm_render_Data;
 
+// the part of the draw list built from a contiguous range of the flattened model tree
+typedef struct wrm_render_Chunk {
+    u32 start; // first position in the flattened tree; entries are written from the same index of `wrm_tbd`
+    u32 end;
+    bool *moved; // whether each world transform changed this frame, by position; shared by all chunks
+    u32 done_root; // position of a root updated before the chunks ran, as its children were split off; else WRM_POOL_NO_SLOT
+    size_t len; // entries written
+    u32 transform_cnt;
+    u32 culled_cnt;
+} wrm_render_Chunk;
+
+/*
+View frustum planes, normalized, pointing inwards: `dot(n, p) + w >= 0` inside
+Also kept split by component and padded to 8 with planes that hold everything,
+so a sphere is tested against four of them at a time where SSE2 is available
+*/
+typedef struct wrm_render_Frustum {
+    vec4 planes[6];
+    float x[8];
+    float y[8];
+    float z[8];
+    float w[8];
+} wrm_render_Frustum;
+
 /*
 Constants
 */
@@ -36,10 +63,20 @@ const float WRM_FAR_CLIP_DISTANCE = 1000.0f;
 
 const u32 WRM_RENDER_POOL_INITIAL_CAPACITY = 20;
 
-// list constants
+// instancing constants
+
+// shortest run of draws sharing their mesh, shader and texture that is drawn with a single instanced call
+const u32 WRM_RENDER_INSTANCING_MIN_RUN = 2;
+
+// worker constants
 
-const u32 WRM_RENDER_LIST_INITIAL_CAPACITY = 10;
-const u32 WRM_RENDER_LIST_SCALE_FACTOR = 2;
+// fewest models in the hierarchy for building the draw list to be split across the workers
+const u32 WRM_RENDER_PARALLEL_MIN_MODELS = 4096;
+
+// frame arena constants
+
+const size_t WRM_RENDER_FRAME_INITIAL_CAPACITY = 64 * 1024;
+const size_t WRM_RENDER_FRAME_MAX_CAPACITY = 256 * 1024 * 1024;
 
 /*
 Globals
@@ -60,9 +97,15 @@ wrm_Pool wrm_models;
 
 wrm_Tree wrm_model_tree;
 
+wrm_Frame_Arena wrm_render_frame;
+
+const wrm_Allocator *wrm_render_allocator;
+
 bool wrm_show_ui;
 bool wrm_render_debug_frame;
 u32 wrm_ui_count;
+u32 wrm_render_transform_cnt;
+u32 wrm_render_culled_cnt;
 
 
 // SDL data 
@@ -76,9 +119,15 @@ wrm_RGBAf wrm_bg_color; // background color
 int wrm_window_height;
 int wrm_window_width;
 vec3 wrm_world_up = {0.0f, 1.0f, 0.0f};
+GLuint wrm_instance_vbo; // per-instance model matrices of the frame's instanced draws
+GLuint wrm_camera_ubo; // the frame's `wrm_Camera_Uniforms`, bound at `WRM_SHADER_CAMERA_BINDING`
+wrm_render_Frustum wrm_frustum; // of the frame's camera; only read while the draw list is built
 
-/* a list of models to be drawn (used solely in render_draw() )*/
-wrm_Stack wrm_tbd;
+/* a list of models to be drawn (used solely in render_draw() ), pushed to the frame arena */
+wrm_render_Data *wrm_tbd;
+size_t wrm_tbd_len;
+/* sort key of each entry of `wrm_tbd`, sorted into draw order; the entries themselves stay put */
+wrm_Sort_Key *wrm_tbd_keys;
 
 /*
 Helpers (internal to just this file)
@@ -88,21 +137,34 @@ static void wrm_render_initMemory(void);
 // sets the GL state before a draw call
 static void wrm_render_updateGLState(wrm_render_Data *curr, wrm_render_Data *prev, u32 *count, GLenum *mode, bool *indexed);
 // draws a model from the given render data
-static void wrm_render_drawModel(wrm_render_Data *draw_data, mat4 view, mat4 persp, u32 count, GLenum mode, bool indexed);
+static void wrm_render_drawModel(wrm_render_Data *draw_data, mat4 vp, u32 count, GLenum mode, bool indexed);
+// counts the draws from position `start` in the sorted list that share its mesh, shader, texture and transparency
+static size_t wrm_render_runLength(size_t start);
+// draws the `run` models from position `start` in the sorted list with a single instanced call
+static void wrm_render_drawInstanced(size_t start, size_t run, u32 count, GLenum mode, bool indexed);
 // pack position, rotation, and scale into a transform matrix
 static void wrm_render_packTransform(vec3 pos, vec3 rot, vec3 scale, mat4 transform);
 // creates a list from the pool of models, sorted by GL state changes
 static void wrm_render_prepareModels(void);
-// adds a model and its children recursively to the TBD list
-static void wrm_render_addModelAndChildren(wrm_Handle m_handle, mat4 parent_transform);
-// compares two render data objects for sorting by GL state changes
-static int wrm_render_compareRenderData(const void *model1, const void *model2);
+// brings the cached transforms of the model at position `pos` of the flattened tree up to date; returns whether they changed
+static bool wrm_render_updateTransform(wrm_Tree *tree, u32 pos, bool *moved);
+// builds the draw list entries of chunk `part` of the array `chunks`; run as a job, so on any thread
+static void wrm_render_buildChunk(void *chunks, u32 part);
+// extracts the frustum planes of the view-projection matrix `vp` into `wrm_frustum`
+static void wrm_render_setFrustum(mat4 vp);
+// checks whether `mesh` with world transform `transform` is wholly outside `wrm_frustum`
+static bool wrm_render_isCulled(const wrm_Mesh *mesh, mat4 transform);
+// adds a single model with the given world transform to the chunk's part of the TBD list, if it can be drawn
+static void wrm_render_addModel(wrm_render_Chunk *c, wrm_Handle model, wrm_Model *m, mat4 transform);
+// packs the GL state and depth of a draw into a key that sorts into draw order
+static u64 wrm_render_sortKey(bool transparent, wrm_Handle shader, wrm_Handle texture, wrm_Handle mesh, float distance);
 
 // user-visible 
 
-bool wrm_render_init(const wrm_render_Settings *s, const wrm_Window_Data *data)
+bool wrm_render_init(const wrm_render_Settings *s, const wrm_Window_Data *data, const wrm_Allocator *allocator)
 {
     wrm_render_settings = *s;
+    wrm_render_allocator = allocator;
 
     if(SDL_Init(SDL_INIT_VIDEO)) {
         fprintf(stderr, "ERROR: Render: failed to initialize SDL\n");
@@ -141,10 +203,22 @@ bool wrm_render_init(const wrm_render_Settings *s, const wrm_Window_Data *data)
     }
     if(wrm_render_settings.verbose) printf("Render: loaded GL functions\n");
 
+    glGenBuffers(1, &wrm_instance_vbo);
+
+    glGenBuffers(1, &wrm_camera_ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, wrm_camera_ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(wrm_Camera_Uniforms), NULL, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, WRM_SHADER_CAMERA_BINDING, wrm_camera_ubo);
+
     // setup resource lists
     wrm_render_initMemory();
     if(wrm_render_settings.verbose) printf("Render: created resource pools\n");
 
+    if(!wrm_render_initWorkers()) {
+        wrm_error("Render", "init()", "unable to start worker threads!");
+        return false;
+    }
+
     // add default resources to each list: the handle value 0 refers to these
     // setup default shaders
     if(!wrm_render_createDefaultShaders(wrm_render_settings.shaders_dir)) {
@@ -157,7 +231,11 @@ bool wrm_render_init(const wrm_render_Settings *s, const wrm_Window_Data *data)
         return false;
     }
 
-    
+    // the default resources are still live at quit without being leaks
+    wrm_memoryExpect(&wrm_shaders);
+    wrm_memoryExpect(&wrm_textures);
+    wrm_memoryExpect(&wrm_meshes);
+    wrm_memoryExpect(&wrm_models);
     if(wrm_render_settings.verbose) printf("Render: created default resources\n");
 
     // initialize GL data
@@ -181,13 +259,26 @@ void wrm_render_quit(void)
 {
     if(!wrm_render_is_initialized) return;
 
+    if(wrm_render_settings.verbose) {
+        printf("Render: memory use at quit:\n");
+        wrm_memoryDump(stdout, false);
+    }
+    wrm_memoryReportLeaks(&wrm_models);
+    wrm_memoryReportLeaks(&wrm_meshes);
+    wrm_memoryReportLeaks(&wrm_textures);
+    wrm_memoryReportLeaks(&wrm_shaders);
+
     wrm_Pool_delete(&wrm_shaders, wrm_Shader_delete);
     wrm_Pool_delete(&wrm_textures, wrm_Texture_delete);
     wrm_Pool_delete(&wrm_meshes, wrm_Mesh_delete);
+    wrm_Tree_delete(&wrm_model_tree);
     wrm_Pool_delete(&wrm_models, wrm_Model_delete);
 
-    wrm_Stack_delete(&wrm_tbd, NULL);
+    wrm_Frame_Arena_delete(&wrm_render_frame);
+    wrm_render_quitWorkers();
 
+    glDeleteBuffers(1, &wrm_instance_vbo);
+    glDeleteBuffers(1, &wrm_camera_ubo);
     SDL_GL_DeleteContext(wrm_gl_context);
     
     if(wrm_window) {
@@ -201,41 +292,69 @@ void wrm_render_quit(void)
 void wrm_render_draw(void) 
 {
     // handle camera and get view matrix
-    mat4 view;
-    wrm_render_getViewMatrix(view);
+    wrm_Camera_Uniforms camera;
+    wrm_render_getViewMatrix(camera.view);
 
     // get the perspective projection matrix (account for changes in window dimensions and camera fov)
-    mat4 persp;
     float aspect_ratio = (float) wrm_window_width / (float) wrm_window_height;
-    glm_perspective(wrm_camera.fov, aspect_ratio, WRM_NEAR_CLIP_DISTANCE, WRM_FAR_CLIP_DISTANCE, persp);
+    glm_perspective(wrm_camera.fov, aspect_ratio, WRM_NEAR_CLIP_DISTANCE, WRM_FAR_CLIP_DISTANCE, camera.proj);
+    glm_mat4_mul(camera.proj, camera.view, camera.view_proj);
+    wrm_render_setFrustum(camera.view_proj);
+
+    // upload the camera once; every shader reading the camera block sees it
+    glBindBuffer(GL_UNIFORM_BUFFER, wrm_camera_ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(wrm_Camera_Uniforms), &camera);
 
     // prepare a list of models for rendering
     wrm_render_prepareModels();
     
     // initialize GL state and tracking of changes
     wrm_render_Data *prev = NULL;
-    wrm_render_Data *curr = wrm_tbd.data;
     u32 count = 0;
     GLenum mode = 0;
     bool indexed = false;
 
     if(wrm_render_debug_frame) {
-        printf("\nFRAME DRAW DATA:\n\nMAIN (3D) PASS (%zu model%s to be drawn):\n", wrm_tbd.len, wrm_tbd.len == 1 ? "" : "s");
+        printf("\nFRAME DRAW DATA:\n\nMAIN (3D) PASS (%zu model%s to be drawn):\n", wrm_tbd_len, wrm_tbd_len == 1 ? "" : "s");
     }
 
     // clear the screen
     glClearColor(wrm_bg_color.r, wrm_bg_color.g, wrm_bg_color.b, wrm_bg_color.a);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     
-    // render all the opaque models to backbuffer
-    for(size_t i = 0; i < wrm_tbd.len; i++) {
-        if(wrm_render_debug_frame) { wrm_render_debugModel(curr->src_model); }
+    // one slot per draw, so each instanced run uploads to the range matching its place in the list
+    if(wrm_tbd_len) {
+        glBindBuffer(GL_ARRAY_BUFFER, wrm_instance_vbo);
+        glBufferData(GL_ARRAY_BUFFER, wrm_tbd_len * sizeof(mat4), NULL, GL_STREAM_DRAW);
+    }
+
+    // render all the models to backbuffer, a run of identical state at a time
+    size_t run;
+    for(size_t i = 0; i < wrm_tbd_len; i += run) {
+        wrm_render_Data *curr = &wrm_tbd[wrm_tbd_keys[i].idx];
+        run = wrm_render_runLength(i);
+
+        // a run with an instanced variant of its shader draws with that instead
+        wrm_Option_Ref instanced = wrm_data_AS(wrm_shaders, wrm_Shader)[curr->shader].instanced;
+        bool instancing = run >= WRM_RENDER_INSTANCING_MIN_RUN && instanced.exists && wrm_Pool_peekRef(&wrm_shaders, instanced.val);
+        if(!instancing) { run = 1; }
+
+        for(size_t j = i; j < i + run; j++) {
+            wrm_render_Data *d = &wrm_tbd[wrm_tbd_keys[j].idx];
+            if(wrm_render_debug_frame) { wrm_render_debugModel(d->src_model); }
+            // so that the state tracking sees the program actually bound
+            if(instancing) { d->shader = instanced.val.idx; }
+        }
 
         wrm_render_updateGLState(curr, prev, &count, &mode, &indexed);
-        wrm_render_drawModel(curr, view, persp, count, mode, indexed);
+        if(instancing) {
+            wrm_render_drawInstanced(i, run, count, mode, indexed);
+        }
+        else {
+            wrm_render_drawModel(curr, camera.view_proj, count, mode, indexed);
+        }
 
-        prev = curr;
-        curr++;
+        prev = &wrm_tbd[wrm_tbd_keys[i + run - 1].idx];
     }
 }
 
@@ -244,6 +363,9 @@ void wrm_render_present(void)
     // swap the buffers to present the completed frame
     if(wrm_render_debug_frame) wrm_render_debug_frame = false;
     SDL_GL_SwapWindow(wrm_window);
+
+    // everything pushed to the frame arena two frames ago is now released
+    wrm_Frame_Arena_swap(&wrm_render_frame);
 }
 
 SDL_Window *wrm_render_getWindow(void)
@@ -251,6 +373,11 @@ SDL_Window *wrm_render_getWindow(void)
     return wrm_window;
 }
 
+u32 wrm_render_getTransformCount(void)
+{
+    return wrm_render_transform_cnt;
+}
+
 void wrm_render_onWindowResize(void) 
 {
     SDL_GL_GetDrawableSize(wrm_window, &wrm_window_width, &wrm_window_height);
@@ -264,33 +391,33 @@ void wrm_render_debugFrame(void)
     printf("DEBUG: Render:\n\nINTERNAL DATA\n");
 
     printf("\nShaders: %zu total (memory for %zu):\n", wrm_shaders.used_cnt, wrm_shaders.cap);
-    for(u32 i = 0; i < wrm_shaders.cap; i++) {
-        if(wrm_shaders.in_use[i]) {
-            wrm_render_debugShader(i);
-        }
+    wrm_Pool_FOR_EACH(&wrm_shaders, i) {
+        wrm_render_debugShader(i);
     }
 
     printf("\nTextures: %zu total (memory for %zu):\n", wrm_textures.used_cnt, wrm_textures.cap);
-    for(u32 i = 0; i < wrm_textures.cap; i++) {
-        if(wrm_textures.in_use[i]) {
-            wrm_render_debugTexture(i);
-        }
+    wrm_Pool_FOR_EACH(&wrm_textures, i) {
+        wrm_render_debugTexture(i);
     }
 
     printf("\nMeshes: %zu total (memory for %zu):\n", wrm_meshes.used_cnt, wrm_meshes.cap);
-    for(u32 i = 0; i < wrm_meshes.cap; i++) {
-        if(wrm_meshes.in_use[i]) {
-            wrm_render_debugMesh(i);
-        }
+    wrm_Pool_FOR_EACH(&wrm_meshes, i) {
+        wrm_render_debugMesh(i);
     }
 
     printf("\nModels: %zu total (memory for %zu):\n", wrm_models.used_cnt, wrm_models.cap);
-    for(u32 i = 0; i < wrm_models.cap; i++) {
-        if(wrm_models.in_use[i]) {
-            wrm_render_debugModel(i);
-        }
+    wrm_Pool_FOR_EACH(&wrm_models, i) {
+        wrm_render_debugModel(i);
     }
 
+    wrm_Arena *frame = wrm_Frame_Arena_get(&wrm_render_frame);
+    printf(
+        "\nFrame arena (frame %llu): %zu bytes in use, peak %zu, %zu committed, %zu commits, %zu pushes\n",
+        (unsigned long long)wrm_render_frame.frame, frame->pos, frame->peak, frame->cap, frame->commit_cnt, frame->push_cnt
+    );
+    printf("\nTransforms recomputed last frame: %u of %zu models\n", wrm_render_transform_cnt, wrm_models.used_cnt);
+    printf("Models last frame: %zu drawn, %u culled\n", wrm_tbd_len, wrm_render_culled_cnt);
+
     wrm_render_debugCamera();
 }
 
@@ -350,19 +477,19 @@ bool wrm_render_exists(wrm_Handle h, wrm_render_Resource_Type t, const char *cal
     switch(t) {
         case WRM_RENDER_RESOURCE_SHADER:
             type = "shader";
-            result = h < wrm_shaders.cap && wrm_shaders.in_use[h];
+            result = wrm_Pool_isValid(&wrm_shaders, h);
             break;
         case WRM_RENDER_RESOURCE_TEXTURE:
             type = "texture";
-            result = h < wrm_textures.cap && wrm_textures.in_use[h];
+            result = wrm_Pool_isValid(&wrm_textures, h);
             break;
         case WRM_RENDER_RESOURCE_MESH:
             type = "mesh";
-            result = h < wrm_meshes.cap && wrm_meshes.in_use[h];
+            result = wrm_Pool_isValid(&wrm_meshes, h);
             break;
         case WRM_RENDER_RESOURCE_MODEL:
             type = "model";
-            result = h < wrm_models.cap && wrm_models.in_use[h];
+            result = wrm_Pool_isValid(&wrm_models, h);
             break;
         default:
             if(wrm_render_settings.errors) wrm_error("Render", "exists()", "invalid resource type [%d]\n", t);
@@ -375,88 +502,273 @@ bool wrm_render_exists(wrm_Handle h, wrm_render_Resource_Type t, const char *cal
 
 void wrm_render_setGLShader(wrm_Handle shader);
 void wrm_render_setGLTexture(wrm_Handle texture);
+GLint wrm_render_uniform(const wrm_Shader *s, wrm_Shader_Uniform u);
 
 // helpers
 
 static void wrm_render_initMemory(void)
 {
-    wrm_Pool_init(&wrm_shaders, WRM_RENDER_POOL_INITIAL_CAPACITY, sizeof(wrm_Shader), true);
-    wrm_Pool_init(&wrm_textures, WRM_RENDER_POOL_INITIAL_CAPACITY, sizeof(wrm_Texture), true);
-    wrm_Pool_init(&wrm_meshes, WRM_RENDER_POOL_INITIAL_CAPACITY, sizeof(wrm_Mesh), true);
-    wrm_Pool_init(&wrm_models, WRM_RENDER_POOL_INITIAL_CAPACITY, sizeof(wrm_Model), true);
+    wrm_Pool_init(&wrm_shaders, WRM_RENDER_POOL_INITIAL_CAPACITY, sizeof(wrm_Shader), true, wrm_render_allocator);
+    wrm_Pool_init(&wrm_textures, WRM_RENDER_POOL_INITIAL_CAPACITY, sizeof(wrm_Texture), true, wrm_render_allocator);
+    wrm_Pool_init(&wrm_meshes, WRM_RENDER_POOL_INITIAL_CAPACITY, sizeof(wrm_Mesh), true, wrm_render_allocator);
+    wrm_Pool_initDense(&wrm_models, WRM_RENDER_POOL_INITIAL_CAPACITY, sizeof(wrm_Model), true, wrm_render_allocator);
 
-    wrm_Stack_init(&wrm_tbd, WRM_RENDER_LIST_INITIAL_CAPACITY, sizeof(wrm_render_Data), true);
+    wrm_Frame_Arena_init(&wrm_render_frame, WRM_RENDER_FRAME_INITIAL_CAPACITY, WRM_RENDER_FRAME_MAX_CAPACITY);
 
-    wrm_Tree_init(&wrm_model_tree, &wrm_models, offsetof(wrm_Model, tree_node), WRM_MODEL_CHILD_LIMIT, true);
+    wrm_Tree_initFlat(&wrm_model_tree, &wrm_models, offsetof(wrm_Model, tree_node), wrm_render_allocator);
+
+    wrm_memoryTrack("wrm_shaders", WRM_MEMORY_POOL, &wrm_shaders);
+    wrm_memoryTrack("wrm_textures", WRM_MEMORY_POOL, &wrm_textures);
+    wrm_memoryTrack("wrm_meshes", WRM_MEMORY_POOL, &wrm_meshes);
+    wrm_memoryTrack("wrm_models", WRM_MEMORY_POOL, &wrm_models);
+    wrm_memoryTrack("wrm_tbd", WRM_MEMORY_FRAME_ARENA, &wrm_render_frame);
 
     wrm_ui_count = 0;
 }
 
 static void wrm_render_prepareModels(void)
 {
-    // clear the list
-    wrm_Stack_reset(&wrm_tbd, 0);
+    wrm_Arena *frame = wrm_Frame_Arena_get(&wrm_render_frame);
+    wrm_tbd_len = 0;
+    wrm_render_transform_cnt = 0;
+    wrm_render_culled_cnt = 0;
+
+    // lay the hierarchy out in pre-order; this only does work after it changed
+    wrm_Tree *tree = &wrm_model_tree;
+    if(!wrm_Tree_flatten(tree)) {
+        wrm_error("Render", "prepareModels()", "failed to flatten the model tree!");
+        return;
+    }
 
-    for(u32 i = 0; i < wrm_models.cap; i++) {
-        wrm_Model *m = wrm_Pool_at(&wrm_models, i);
-        if(m && !m->tree_node.has_parent) {
-            wrm_render_addModelAndChildren(i, NULL);
+    // each model is drawn at most once, so the list needs at most one entry per position
+    u32 len = tree->flat_len;
+    if(!len) { return; }
+    wrm_tbd = wrm_Arena_PUSH(frame, wrm_render_Data, len);
+    wrm_tbd_keys = wrm_Arena_PUSH(frame, wrm_Sort_Key, len);
+    bool *moved = wrm_Arena_PUSH(frame, bool, len);
+    if(!wrm_tbd || !wrm_tbd_keys || !moved) {
+        wrm_error("Render", "prepareModels()", "failed to allocate space for the draw list!");
+        return;
+    }
+    memset(moved, 0, len * sizeof(bool));
+
+    // split between roots, and between the subtrees right under a shown root: a parent
+    // is then in the same chunk as its children, except for the roots split this way
+    u32 parts = len < WRM_RENDER_PARALLEL_MIN_MODELS ? 1 : wrm_render_workerCount();
+    wrm_render_Chunk chunks[WRM_RENDER_MAX_WORKERS + 1];
+    u32 target = len / parts + 1;
+    u32 chunk_cnt = 0;
+    chunks[0] = (wrm_render_Chunk){ .start = 0, .moved = moved, .done_root = WRM_POOL_NO_SLOT };
+
+    u32 open = WRM_POOL_NO_SLOT; // the shown root whose children are being stepped over
+    for(u32 pos = 0; pos < len; ) {
+        const wrm_Model *m = wrm_Pool_slotData(&wrm_models, tree->order[pos]);
+        if(tree->parent_pos[pos] == WRM_POOL_NO_SLOT) { open = m->children_shown ? pos : WRM_POOL_NO_SLOT; }
+        pos += open == pos ? 1 : tree->subtree_len[pos];
+
+        if(pos < len && pos - chunks[chunk_cnt].start >= target && chunk_cnt + 1 < parts) {
+            // the later chunk reads this root, so it is updated now; a root spanning more chunks only needs it once
+            if(open != WRM_POOL_NO_SLOT && pos < open + tree->subtree_len[open] && open >= chunks[chunk_cnt].start) {
+                if(wrm_render_updateTransform(tree, open, moved)) { wrm_render_transform_cnt++; }
+                chunks[chunk_cnt].done_root = open;
+            }
+            chunks[chunk_cnt++].end = pos;
+            chunks[chunk_cnt] = (wrm_render_Chunk){ .start = pos, .moved = moved, .done_root = WRM_POOL_NO_SLOT };
         }
     }
+    chunks[chunk_cnt++].end = len;
+
+    // GL is never touched here, so any thread can build a chunk
+    if(chunk_cnt == 1) { wrm_render_buildChunk(chunks, 0); }
+    else { wrm_render_runJobs(wrm_render_buildChunk, chunks, chunk_cnt); }
 
-    if(wrm_tbd.len > 1) {
-        qsort(wrm_tbd.data, wrm_tbd.len, sizeof(wrm_render_Data), wrm_render_compareRenderData);
+    // merge the chunks' lists, moving each down to follow the last
+    for(u32 i = 0; i < chunk_cnt; i++) {
+        wrm_render_Chunk *c = &chunks[i];
+        if(c->start != wrm_tbd_len) {
+            memmove(wrm_tbd + wrm_tbd_len, wrm_tbd + c->start, c->len * sizeof(wrm_render_Data));
+            memmove(wrm_tbd_keys + wrm_tbd_len, wrm_tbd_keys + c->start, c->len * sizeof(wrm_Sort_Key));
+        }
+        for(size_t k = 0; k < c->len; k++) {
+            wrm_tbd_keys[wrm_tbd_len + k].idx += (u32)wrm_tbd_len;
+        }
+        wrm_tbd_len += c->len;
+        wrm_render_transform_cnt += c->transform_cnt;
+        wrm_render_culled_cnt += c->culled_cnt;
     }
-}
 
-static void wrm_render_addModelAndChildren(wrm_Handle model, mat4 parent_transform)
-{
-    wrm_Model *m = wrm_Pool_at(&wrm_models, model);
+    // the chunks cannot share the snapshot bits, so the rows they changed are marked here
+    if(wrm_models.dirty) {
+        for(u32 pos = 0; pos < len; pos++) {
+            if(moved[pos]) { wrm_Pool_touch(&wrm_models, tree->order[pos]); }
+        }
+    }
 
-    static wrm_render_Data data; // share this between recursive calls
-    wrm_render_packTransform(m->pos, m->rot, m->scale, data.transform);
-    if(parent_transform) {
-        glm_mat4_mul(parent_transform, data.transform, data.transform);
+    // order the keys only; the entries are read through them in the draw loop
+    if(wrm_tbd_len > 1) {
+        wrm_Arena_Marker mark = wrm_Arena_mark(frame);
+        wrm_Sort_Key *tmp = wrm_Arena_PUSH(frame, wrm_Sort_Key, wrm_tbd_len);
+        if(!tmp) {
+            wrm_error("Render", "prepareModels()", "failed to allocate space to sort the draw list!");
+            return;
+        }
+        wrm_radixSort(wrm_tbd_keys, tmp, wrm_tbd_len);
+        wrm_Arena_restore(frame, mark);
     }
+}
 
-    // add the model, if visible
-    if(m->shown) { 
-        data.mesh = m->mesh;
-        data.shader = m->shader;
-        data.texture = m->texture;
-        data.src_model = model;
+static bool wrm_render_updateTransform(wrm_Tree *tree, u32 pos, bool *moved)
+{
+    wrm_Model *m = wrm_Pool_slotData(&wrm_models, tree->order[pos]);
 
-        wrm_Mesh *mesh = wrm_Pool_at(&wrm_meshes, m->mesh);
-        wrm_Texture *texture = wrm_Pool_at(&wrm_textures, m->texture);
-        data.transparent = (mesh && mesh->transparent) || (texture && texture->transparent);
+    // parents always come before their children, so a change reaches the whole subtree
+    u32 parent = tree->parent_pos[pos];
+    moved[pos] = m->transform_dirty || (parent != WRM_POOL_NO_SLOT && moved[parent]);
+    if(!moved[pos]) { return false; }
 
-        if(data.transparent) {
-            data.distance = glm_vec3_distance2(m->pos, wrm_camera.pos); // only care about this if it is transparent
+    // only a model's own change needs the trig; an ancestor's needs just the multiply
+    if(m->transform_dirty) { wrm_render_packTransform(m->pos, m->rot, m->scale, m->local); }
+    if(parent != WRM_POOL_NO_SLOT) {
+        wrm_Model *p = wrm_Pool_slotData(&wrm_models, tree->order[parent]);
+        glm_mat4_mul(p->world, m->local, m->world);
+    }
+    else {
+        glm_mat4_copy(m->local, m->world);
+    }
+    m->transform_dirty = false;
+
+    // hidden children are skipped until shown again, so leave them the change
+    if(!m->children_shown) {
+        u32 end = pos + tree->subtree_len[pos];
+        for(u32 c = pos + 1; c < end; c++) {
+            if(tree->parent_pos[c] == pos) {
+                ((wrm_Model*)wrm_Pool_slotData(&wrm_models, tree->order[c]))->transform_dirty = true;
+                moved[c] = true; // only so that the row is marked for snapshots
+            }
         }
-        wrm_Option_Handle top = wrm_Stack_push(&wrm_tbd);
-        if(!top.exists) {
-            wrm_error("Render", "addModelAndChildren()", "failed to allocate space on draw stack!");
-            return;
+    }
+    return true;
+}
+
+static void wrm_render_buildChunk(void *chunks, u32 part)
+{
+    // counted in a copy on this thread's stack, written back once: neighbouring chunks share cache lines
+    wrm_render_Chunk local = ((wrm_render_Chunk*)chunks)[part];
+    wrm_render_Chunk *c = &local;
+    wrm_Tree *tree = &wrm_model_tree;
+
+    for(u32 pos = c->start; pos < c->end; pos++) {
+        wrm_Handle model = tree->order[pos];
+        wrm_Model *m = wrm_Pool_slotData(&wrm_models, model);
+
+        // a root split from its children was brought up to date before the chunks ran
+        if(pos != c->done_root && wrm_render_updateTransform(tree, pos, c->moved)) {
+            c->transform_cnt++;
         }
-        memcpy(wrm_Stack_at(&wrm_tbd, top.val), &data, sizeof(data));
+
+        wrm_render_addModel(c, model, m, m->world);
+
+        // hidden children: skip the rest of this subtree
+        if(!m->children_shown) { pos += tree->subtree_len[pos] - 1; }
     }
-    
-    // done if no children
-    if(!(m->tree_node.child_cnt && m->children_shown)) { return; }
 
-    // add lone child
-    if(m->tree_node.child_cnt == 1) {
-        wrm_render_addModelAndChildren(m->tree_node.children, data.transform);
+    ((wrm_render_Chunk*)chunks)[part] = local;
+}
+
+static void wrm_render_addModel(wrm_render_Chunk *c, wrm_Handle model, wrm_Model *m, mat4 transform)
+{
+    if(!m->shown) { return; }
+
+    // add the model only if none of its resources have been deleted:
+    // this is the only check, so the draw loop can index the pools directly
+    // (read-only, as other chunks may be checking the same resources)
+    const wrm_Mesh *mesh = wrm_Pool_peekRef(&wrm_meshes, m->mesh);
+    const wrm_Texture *texture = wrm_Pool_peekRef(&wrm_textures, m->texture);
+    if(!(mesh && texture && wrm_Pool_peekRef(&wrm_shaders, m->shader))) { return; }
+
+    if(wrm_render_isCulled(mesh, transform)) {
+        c->culled_cnt++;
         return;
     }
 
-    // add children list
-    u32 *children = wrm_Pool_at(&wrm_model_tree.child_lists, m->tree_node.children);
-    for(u8 i = 0; i < m->tree_node.child_cnt; i++) {
-        wrm_render_addModelAndChildren(children[i], data.transform);
+    u32 i = (u32)c->len++;
+    wrm_render_Data *data = &wrm_tbd[c->start + i];
+    glm_mat4_copy(transform, data->transform);
+    data->mesh = m->mesh.idx;
+    data->shader = m->shader.idx;
+    data->texture = m->texture.idx;
+    data->src_model = model;
+    data->transparent = mesh->transparent || texture->transparent;
+
+    // distance from the camera to the model's world position; the index is within the chunk until they are merged
+    float distance = glm_vec3_distance(transform[3], wrm_camera.pos);
+    wrm_tbd_keys[c->start + i] = (wrm_Sort_Key){
+        .key = wrm_render_sortKey(data->transparent, data->shader, data->texture, data->mesh, distance),
+        .idx = i
+    };
+}
+
+static void wrm_render_setFrustum(mat4 vp)
+{
+    wrm_render_Frustum *f = &wrm_frustum;
+    glm_frustum_planes(vp, f->planes);
+
+    for(u32 i = 0; i < 8; i++) {
+        bool real = i < 6;
+        f->x[i] = real ? f->planes[i][0] : 0.0f;
+        f->y[i] = real ? f->planes[i][1] : 0.0f;
+        f->z[i] = real ? f->planes[i][2] : 0.0f;
+        f->w[i] = real ? f->planes[i][3] : FLT_MAX;
     }
 }
 
+static bool wrm_render_isCulled(const wrm_Mesh *mesh, mat4 transform)
+{
+    // the bounding sphere in world space, grown by the largest axis scale so that it still holds the mesh
+    vec3 center;
+    glm_mat4_mulv3(transform, (float*)mesh->sphere, 1.0f, center);
+    float scale2 = glm_vec3_norm2(transform[0]);
+    float sy2 = glm_vec3_norm2(transform[1]);
+    float sz2 = glm_vec3_norm2(transform[2]);
+    if(sy2 > scale2) { scale2 = sy2; }
+    if(sz2 > scale2) { scale2 = sz2; }
+    float r = mesh->sphere[3] * sqrtf(scale2);
+
+    // distance to the nearest plane
+    const wrm_render_Frustum *f = &wrm_frustum;
+#ifdef __SSE2__
+    __m128 cx = _mm_set1_ps(center[0]);
+    __m128 cy = _mm_set1_ps(center[1]);
+    __m128 cz = _mm_set1_ps(center[2]);
+    __m128 d[2];
+    for(u32 i = 0; i < 2; i++) {
+        __m128 dx = _mm_mul_ps(_mm_loadu_ps(f->x + 4 * i), cx);
+        __m128 dy = _mm_mul_ps(_mm_loadu_ps(f->y + 4 * i), cy);
+        __m128 dz = _mm_mul_ps(_mm_loadu_ps(f->z + 4 * i), cz);
+        d[i] = _mm_add_ps(_mm_add_ps(_mm_add_ps(dx, dy), dz), _mm_loadu_ps(f->w + 4 * i));
+    }
+    // fold the eight distances down to the smallest, in the lowest lane
+    __m128 m = _mm_min_ps(d[0], d[1]);
+    m = _mm_min_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 0, 3, 2)));
+    m = _mm_min_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+    float nearest = _mm_cvtss_f32(m);
+#else
+    float nearest = FLT_MAX;
+    for(u32 i = 0; i < 8; i++) {
+        float d = f->x[i] * center[0] + f->y[i] * center[1] + f->z[i] * center[2] + f->w[i];
+        nearest = d < nearest ? d : nearest;
+    }
+#endif
+
+    if(nearest < -r) { return true; } // wholly behind one plane
+    if(nearest >= r) { return false; } // wholly in front of all of them
+
+    // the sphere crosses a plane: the box fits long, thin meshes more tightly
+    vec3 box[2];
+    glm_aabb_transform((vec3*)mesh->aabb, transform, box);
+    return !glm_aabb_frustum(box, (vec4*)f->planes);
+}
+
 static void wrm_render_updateGLState(wrm_render_Data *curr, wrm_render_Data *prev, u32 *count, GLenum *mode, bool *indexed)
 {
     if(!curr) return;
@@ -474,12 +786,14 @@ static void wrm_render_updateGLState(wrm_render_Data *curr, wrm_render_Data *pre
         glDisable(GL_DEPTH_TEST);
     }
     
+    // handles in the draw list were all resolved in prepareModels()
     if(!prev || curr->shader != prev->shader) {
-        wrm_render_setGLShader(curr->shader);
+        glUseProgram(wrm_data_AS(wrm_shaders, wrm_Shader)[curr->shader].program);
     }
     
     if(!prev || curr->texture != prev->texture) {
-        wrm_render_setGLTexture(curr->texture);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, wrm_data_AS(wrm_textures, wrm_Texture)[curr->texture].gl_tex);
     }
 
     if(!prev || curr->mesh != prev->mesh) {
@@ -492,19 +806,19 @@ static void wrm_render_updateGLState(wrm_render_Data *curr, wrm_render_Data *pre
     }
 }
 
-void wrm_render_drawModel(wrm_render_Data *draw_data, mat4 view, mat4 persp, u32 count, GLenum mode, bool indexed)
+void wrm_render_drawModel(wrm_render_Data *draw_data, mat4 vp, u32 count, GLenum mode, bool indexed)
 {
-    wrm_Shader* shader = wrm_Pool_at(&wrm_shaders, draw_data->shader);
-
-    if(!shader) { return; }
+    wrm_Shader* shader = wrm_data_AS(wrm_shaders, wrm_Shader) + draw_data->shader;
 
-    GLint mvp_loc = glGetUniformLocation(shader->program, "mvp");
-    if(mvp_loc != -1) {
-        // calculate MVP matrix
+    // the camera comes from its uniform buffer, so only the model matrix changes per draw
+    GLint model_loc = wrm_render_uniform(shader, WRM_SHADER_UNIFORM_MODEL);
+    GLint mvp_loc = wrm_render_uniform(shader, WRM_SHADER_UNIFORM_MVP);
+    if(model_loc != -1) {
+        glUniformMatrix4fv(model_loc, 1, GL_FALSE, (float*)draw_data->transform);
+    }
+    else if(mvp_loc != -1) {
         mat4 mvp;
-        glm_mat4_copy(draw_data->transform, mvp); // model first
-        glm_mat4_mul(view, mvp, mvp);
-        glm_mat4_mul(persp, mvp, mvp);
+        glm_mat4_mul(vp, draw_data->transform, mvp);
         glUniformMatrix4fv(mvp_loc, 1, GL_FALSE, (float*)mvp);
     }
 
@@ -516,6 +830,61 @@ void wrm_render_drawModel(wrm_render_Data *draw_data, mat4 view, mat4 persp, u32
     }
 }
 
+static size_t wrm_render_runLength(size_t start)
+{
+    wrm_render_Data *first = &wrm_tbd[wrm_tbd_keys[start].idx];
+
+    size_t end = start + 1;
+    while(end < wrm_tbd_len) {
+        wrm_render_Data *d = &wrm_tbd[wrm_tbd_keys[end].idx];
+        if(d->mesh != first->mesh || d->shader != first->shader || d->texture != first->texture || d->transparent != first->transparent) { break; }
+        end++;
+    }
+    return end - start;
+}
+
+static void wrm_render_drawInstanced(size_t start, size_t run, u32 count, GLenum mode, bool indexed)
+{
+    // gather the run's model matrices; the entries themselves are scattered through the draw list
+    wrm_Arena *frame = wrm_Frame_Arena_get(&wrm_render_frame);
+    wrm_Arena_Marker mark = wrm_Arena_mark(frame);
+    mat4 *models = wrm_Arena_PUSH(frame, mat4, run);
+    if(!models) {
+        wrm_error("Render", "drawInstanced()", "failed to allocate space for the instance matrices!");
+        return;
+    }
+    for(size_t i = 0; i < run; i++) {
+        glm_mat4_copy(wrm_tbd[wrm_tbd_keys[start + i].idx].transform, models[i]);
+    }
+
+    GLintptr offset = (GLintptr)(start * sizeof(mat4));
+    glBindBuffer(GL_ARRAY_BUFFER, wrm_instance_vbo);
+    glBufferSubData(GL_ARRAY_BUFFER, offset, run * sizeof(mat4), models);
+    wrm_Arena_restore(frame, mark);
+
+    // a mat4 attribute takes one location per column, each pointed at the run's range of the buffer
+    for(u32 c = 0; c < 4; c++) {
+        u32 loc = WRM_SHADER_ATTRIB_INSTANCE_LOC + c;
+        glEnableVertexAttribArray(loc);
+        glVertexAttribPointer(loc, 4, GL_FLOAT, GL_FALSE, sizeof(mat4), (void*)(offset + c * sizeof(vec4)));
+        glVertexAttribDivisor(loc, 1);
+    }
+
+    if(indexed) {
+        glDrawElementsInstanced(mode, count, GL_UNSIGNED_INT, NULL, (GLsizei)run);
+    }
+    else {
+        glDrawArraysInstanced(mode, 0, count, (GLsizei)run);
+    }
+
+    // the VAO is shared with single draws, which must not keep reading the per-instance locations
+    for(u32 c = 0; c < 4; c++) {
+        u32 loc = WRM_SHADER_ATTRIB_INSTANCE_LOC + c;
+        glVertexAttribDivisor(loc, 0);
+        glDisableVertexAttribArray(loc);
+    }
+}
+
 static void wrm_render_packTransform(vec3 pos, vec3 rot, vec3 scale, mat4 transform)
 {
     glm_mat4_identity(transform); // zero this first
@@ -535,28 +904,26 @@ static void wrm_render_packTransform(vec3 pos, vec3 rot, vec3 scale, mat4 transf
     glm_scale(transform, scale);
 }
 
-static int wrm_render_compareRenderData(const void *model1, const void *model2)
+/*
+Opaque draws (top bit clear) come first, grouped by shader, then texture, then mesh,
+nearest first within a group to save overdraw:
+    0 | shader: 16 | texture: 16 | mesh: 16 | depth: 15
+Transparent draws follow from the furthest back, as they must be blended in that
+order; their state only breaks ties:
+    1 | inverted depth: 24 | shader: 13 | texture: 13 | mesh: 13
+Handles too big for their field only group less well; depth is quantized over
+the clip range
+*/
+static u64 wrm_render_sortKey(bool transparent, wrm_Handle shader, wrm_Handle texture, wrm_Handle mesh, float distance)
 {
-    const wrm_render_Data *m1 = (wrm_render_Data*)model1;
-    const wrm_render_Data *m2 = (wrm_render_Data*)model2;
-
-    if(m1->transparent != m2->transparent) {
-        return m1->transparent ? 1 : -1; // fully opaque models get rendered first
-    }
-    if(m1->transparent && m2->transparent) {
-        return m1->distance < m2->distance ? 1 : -1; // further back transparent models get rendered first
-    }
-    if(m1->shader != m2->shader) {
-        return (i64)(m1->shader) - (i64)(m2->shader);
-    }
-
-    if(m1->texture != m2->texture) {
-        return (i64)(m1->texture) - (i64)(m2->texture);
-    }
+    float depth = distance / WRM_FAR_CLIP_DISTANCE;
+    depth = depth < 0.0f ? 0.0f : (depth > 1.0f ? 1.0f : depth);
 
-    if(m1->mesh != m2->mesh) {
-        return (i64)(m1->mesh) - (i64)(m2->mesh);
+    if(!transparent) {
+        u64 q = (u64)(depth * 0x7FFF);
+        return ((u64)(shader & 0xFFFF) << 47) | ((u64)(texture & 0xFFFF) << 31) | ((u64)(mesh & 0xFFFF) << 15) | q;
     }
 
-    return 0;
+    u64 q = 0xFFFFFF - (u64)(depth * 0xFFFFFF);
+    return ((u64)1 << 63) | (q << 39) | ((u64)(shader & 0x1FFF) << 26) | ((u64)(texture & 0x1FFF) << 13) | (u64)(mesh & 0x1FFF);
 }
\ No newline at end of file
@@ -19,12 +19,36 @@ Globals are defined/managed in their render.c
 Internal type definitions
 */
 
+// most worker threads the renderer starts, besides the thread that owns the GL context
+#define WRM_RENDER_MAX_WORKERS 15
+
+// most active uniforms a shader's lookup-by-name table holds; any past it can only be found through the enumeration
+#define WRM_SHADER_MAX_UNIFORMS 16
+
+// uniforms the renderer itself sets; see `WRM_SHADER_UNIFORM_NAMES` for their names in GLSL
+typedef enum wrm_Shader_Uniform {
+    WRM_SHADER_UNIFORM_MODEL,
+    WRM_SHADER_UNIFORM_MVP, // for shaders that do not read the camera block
+    WRM_SHADER_UNIFORM_TEX,
+    WRM_SHADER_UNIFORM_TEXT_COL,
+    WRM_SHADER_UNIFORM_CNT
+} wrm_Shader_Uniform;
+
 // shader GL data, plus requirements of meshes rendered with it
 typedef struct wrm_Shader {
     wrm_render_Format format;
     GLuint vert;
     GLuint frag;
     GLuint program;
+    // variant drawing many copies of a mesh at once from per-instance model matrices, if there is one
+    wrm_Option_Ref instanced;
+
+    // uniform locations, read once from the linked program; -1 where the program does not use it
+    GLint uniforms[WRM_SHADER_UNIFORM_CNT];
+    // every active uniform by the hash of its name, for those outside of the enumeration
+    u64 uniform_hashes[WRM_SHADER_MAX_UNIFORMS];
+    GLint uniform_locs[WRM_SHADER_MAX_UNIFORMS];
+    u32 uniform_cnt;
 } wrm_Shader;
 
 typedef struct wrm_Texture {
@@ -47,6 +71,10 @@ typedef struct wrm_Mesh {
     GLenum mode;
     bool cw;
     bool transparent;
+
+    // bounds of the positions in model space, for culling
+    vec3 aabb[2];
+    vec4 sphere; // center, then radius
 } wrm_Mesh;
 
 typedef struct wrm_Model {
@@ -54,15 +82,28 @@ typedef struct wrm_Model {
     vec3 rot;
     vec3 scale;
 
-    wrm_Index mesh;
-    wrm_Index texture; // only used when the model has a textured mesh; for now, meshes only use a single texture
-    wrm_Index shader;
+    // cached transforms: `local` from pos, rot and scale, `world` with the ancestors' applied
+    mat4 local;
+    mat4 world;
+    bool transform_dirty; // `local` is out of date, or the model changed parents
+
+    // references go stale if the resource is deleted; such models are not drawn
+    wrm_Ref mesh;
+    wrm_Ref texture; // only used when the model has a textured mesh; for now, meshes only use a single texture
+    wrm_Ref shader;
 
     wrm_Tree_Node tree_node; // tree node for model hierarchy
     bool shown;
     bool children_shown;
 } wrm_Model;
 
+// contents of the per-frame camera uniform buffer; mat4 members need no padding under std140
+typedef struct wrm_Camera_Uniforms {
+    mat4 view;
+    mat4 proj;
+    mat4 view_proj;
+} wrm_Camera_Uniforms;
+
 // camera data
 typedef struct wrm_Camera {
     float offset; // distance forward (positive) or backward (negative) along `facing` from `pos`: used for 3rd-person controls
@@ -103,6 +144,15 @@ extern const u32 WRM_SHADER_ATTRIB_POS_LOC;
 extern const u32 WRM_SHADER_ATTRIB_COL_LOC;
 extern const u32 WRM_SHADER_ATTRIB_UV_LOC;
 /* extern const u32 WRM_SHADER_ATTRIB_NORM_LOC = 3; unused (yet) */
+// first of the four locations an instanced shader reads its per-instance model matrix from
+extern const u32 WRM_SHADER_ATTRIB_INSTANCE_LOC;
+
+// uniform block holding `wrm_Camera_Uniforms`, and the binding point its buffer stays bound to
+extern const char *WRM_SHADER_CAMERA_BLOCK_NAME;
+extern const u32 WRM_SHADER_CAMERA_BINDING;
+
+// GLSL names of the uniforms in `wrm_Shader_Uniform`, in the same order
+extern const char *WRM_SHADER_UNIFORM_NAMES[WRM_SHADER_UNIFORM_CNT];
 
 // shader for color
 
@@ -129,10 +179,18 @@ extern const wrm_Mesh_Data default_meshes_textured_cube;
 
 extern const u32 WRM_RENDER_POOL_INITIAL_CAPACITY;
 
-// list constants
+// instancing constants
+
+extern const u32 WRM_RENDER_INSTANCING_MIN_RUN;
+
+// worker constants
+
+extern const u32 WRM_RENDER_PARALLEL_MIN_MODELS;
 
-extern const u32 WRM_RENDER_LIST_INITIAL_CAPACITY;
-extern const u32 WRM_RENDER_LIST_SCALE_FACTOR;
+// frame arena constants
+
+extern const size_t WRM_RENDER_FRAME_INITIAL_CAPACITY;
+extern const size_t WRM_RENDER_FRAME_MAX_CAPACITY;
 
 /*
 Module-level globals
@@ -147,6 +205,12 @@ extern wrm_Pool wrm_models;
 
 extern wrm_Tree wrm_model_tree;
 
+// scratch memory for data that lives for a frame; swapped in wrm_render_present()
+extern wrm_Frame_Arena wrm_render_frame;
+
+// source of the renderer's memory (NULL for the C heap)
+extern const wrm_Allocator *wrm_render_allocator;
+
 extern wrm_Camera wrm_camera;
 
 extern wrm_render_Settings wrm_render_settings;
@@ -157,6 +221,13 @@ extern int wrm_window_height;
 
 extern bool wrm_render_debug_frame;
 
+// models whose transforms were recomputed while preparing the last frame
+extern u32 wrm_render_transform_cnt;
+// shown models left out of the last frame for being outside the view frustum
+extern u32 wrm_render_culled_cnt;
+// gets `wrm_render_transform_cnt`, for profiling how much of the hierarchy moves each frame
+u32 wrm_render_getTransformCount(void);
+
 extern wrm_Camera wrm_camera;
 
 /*
@@ -186,8 +257,30 @@ creates a GL vertex buffer object (VBO)
 */
 void wrm_render_createVBO(GLuint *vbo, u32 attr_loc, size_t num_entries, size_t values_per_entry, const void *data, GLenum usage);
 
+// hashes a uniform name for `wrm_render_uniformByHash()`; hash names once, not per draw
+u64 wrm_render_uniformHash(const char *name);
+// gets the location of the active uniform in `s` whose name hashes to `name_hash`, or -1 if there is none
+GLint wrm_render_uniformByHash(const wrm_Shader *s, u64 name_hash);
+
+/*
+Worker threads, for CPU work that does not touch GL; the calling thread keeps the GL context
+`initWorkers()` starts one worker per core beyond the first, up to `WRM_RENDER_MAX_WORKERS`
+*/
+bool wrm_render_initWorkers(void);
+void wrm_render_quitWorkers(void);
+// gets how many parts a job can run in at once: the workers plus the calling thread
+u32 wrm_render_workerCount(void);
+// runs `job(arg, part)` for every `part` below `parts` (clamped to the worker count) and returns once all are done; part 0 runs on the calling thread
+void wrm_render_runJobs(wrm_FUNC(job, void, void *arg, u32 part), void *arg, u32 parts);
+
 /* Inline functions to Set GL state */
 
+// gets the cached location of uniform `u` in `s`, or -1 if the shader does not use it
+inline GLint wrm_render_uniform(const wrm_Shader *s, wrm_Shader_Uniform u)
+{
+    return s->uniforms[u];
+}
+
 // Sets the GL shader program to the given WRM shader, if valid 
 inline void wrm_render_setGLShader(wrm_Handle shader)
 {
@@ -5,12 +5,29 @@
 const u32 WRM_SHADER_ATTRIB_POS_LOC = 0;
 const u32 WRM_SHADER_ATTRIB_COL_LOC = 1;
 const u32 WRM_SHADER_ATTRIB_UV_LOC = 2;
+const u32 WRM_SHADER_ATTRIB_INSTANCE_LOC = 4;
+
+const char *WRM_SHADER_CAMERA_BLOCK_NAME = "Camera";
+const u32 WRM_SHADER_CAMERA_BINDING = 0;
 
 const char *WRM_SHADER_DEFAULT_COL_NAME = "default-color";
 const char *WRM_SHADER_DEFAULT_TEX_NAME = "default-texture";
+const char *WRM_SHADER_DEFAULT_COL_INSTANCED_NAME = "default-color-instanced";
+const char *WRM_SHADER_DEFAULT_TEX_INSTANCED_NAME = "default-texture-instanced";
+
+const char *WRM_SHADER_UNIFORM_NAMES[WRM_SHADER_UNIFORM_CNT] = {
+    [WRM_SHADER_UNIFORM_MODEL] = "model",
+    [WRM_SHADER_UNIFORM_MVP] = "mvp",
+    [WRM_SHADER_UNIFORM_TEX] = "tex",
+    [WRM_SHADER_UNIFORM_TEXT_COL] = "text_col"
+};
 
 wrm_Default_Shaders wrm_default_shaders;
 
+// file-internal helper declarations
+static void wrm_render_reflectUniforms(wrm_Shader *s);
+static void wrm_render_addInstancedVariant(const char *shaders_dir, const char *name, wrm_render_Format format, wrm_Handle shader);
+
 // user-visible
 
 wrm_Option_Handle wrm_render_createShader(const char *vert_text, const char *frag_text, wrm_render_Format format)
@@ -21,6 +38,7 @@ wrm_Option_Handle wrm_render_createShader(const char *vert_text, const char *fra
 
     wrm_Shader *s = wrm_Pool_at(&wrm_shaders, pool_result.val);
     s->format = format;
+    s->instanced = OPTION_NONE(Ref); // the slot may hold a deleted shader's link
 
     // first compile the vertex and fragment shaders individually
     wrm_Option_GLuint result = wrm_render_compileShader(vert_text, GL_VERTEX_SHADER);
@@ -54,10 +72,10 @@ wrm_Option_Handle wrm_render_createShader(const char *vert_text, const char *fra
             GLint log_len = 0;
             glGetProgramiv(program, GL_INFO_LOG_LENGTH, &log_len);
 
-            char *log_msg = malloc(log_len * sizeof(char));
+            char *log_msg = wrm_alloc(wrm_render_allocator, log_len * sizeof(char));
             glGetProgramInfoLog(program, log_len, NULL, log_msg);
             fprintf(stderr, "ERROR: Render: failed to link shaders, GL error: %s", log_msg);
-            free(log_msg);
+            wrm_free(wrm_render_allocator, log_msg, log_len * sizeof(char));
         }
 
         wrm_render_deleteShader(result.val);
@@ -68,10 +86,17 @@ wrm_Option_Handle wrm_render_createShader(const char *vert_text, const char *fra
     glDetachShader(program, s->frag);
 
     s->program = program;
+    wrm_render_reflectUniforms(s);
+
+    // shaders reading the camera block all read the same buffer
+    GLuint camera_block = glGetUniformBlockIndex(program, WRM_SHADER_CAMERA_BLOCK_NAME);
+    if(camera_block != GL_INVALID_INDEX) {
+        glUniformBlockBinding(program, camera_block, WRM_SHADER_CAMERA_BINDING);
+    }
 
     if (s->format.tex) {
         glUseProgram(program);
-        GLint tex_uniform = glGetUniformLocation(program, "tex");
+        GLint tex_uniform = wrm_render_uniform(s, WRM_SHADER_UNIFORM_TEX);
         if (tex_uniform != -1) {
             glUniform1i(tex_uniform, 0); // Assumes all your textured shaders use GL_TEXTURE0: can later extend to use multiple textures
         }
@@ -91,14 +116,15 @@ void wrm_render_debugShader(wrm_Handle shader)
     printf(
         "[%u]: {"
         "format: { tex: %s, col: %s, per_pos: %u }, "
-        "vert: %u, frag: %u, program: %u }\n", 
+        "vert: %u, frag: %u, program: %u, uniforms: %u }\n", 
         shader,
         s->format.tex ? "true" : "false", 
         s->format.col ? "true" : "false",
         s->format.per_pos,
         s->vert,
         s->frag,
-        s->program
+        s->program,
+        s->uniform_cnt
     );
 }
 
@@ -111,6 +137,19 @@ void wrm_render_deleteShader(wrm_Handle shader)
 
 // module internal 
 
+u64 wrm_render_uniformHash(const char *name)
+{
+    return wrm_Map_hashBytes(name, strlen(name));
+}
+
+GLint wrm_render_uniformByHash(const wrm_Shader *s, u64 name_hash)
+{
+    for(u32 i = 0; i < s->uniform_cnt; i++) {
+        if(s->uniform_hashes[i] == name_hash) return s->uniform_locs[i];
+    }
+    return -1;
+}
+
 wrm_Option_GLuint wrm_render_compileShader(const char *shader_text, GLenum type) 
 {
     GLuint shader = glCreateShader(type);
@@ -126,11 +165,11 @@ wrm_Option_GLuint wrm_render_compileShader(const char *shader_text, GLenum type)
             GLint log_len = 0;
             glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &log_len);
 
-            char *log_msg = malloc(log_len * sizeof(char));
+            char *log_msg = wrm_alloc(wrm_render_allocator, log_len * sizeof(char));
             glGetShaderInfoLog(shader, log_len, NULL, log_msg);
 
             fprintf(stderr, "ERROR: Render: failed to compile shader, GL error: %s\n Shader source: %s\n", log_msg, shader_text);
-            free(log_msg);
+            wrm_free(wrm_render_allocator, log_msg, log_len * sizeof(char));
         }
 
         return (wrm_Option_GLuint){ .exists = false };
@@ -189,6 +228,10 @@ bool wrm_render_createDefaultShaders(const char *shaders_dir)
     }
     wrm_default_shaders.texture = result.val;
 
+    // without the instanced variants, every model is still drawn one at a time
+    wrm_render_addInstancedVariant(shaders_dir, WRM_SHADER_DEFAULT_COL_INSTANCED_NAME, col_format, wrm_default_shaders.color);
+    wrm_render_addInstancedVariant(shaders_dir, WRM_SHADER_DEFAULT_TEX_INSTANCED_NAME, tex_format, wrm_default_shaders.texture);
+
     return true;
 }
 
@@ -200,8 +243,8 @@ wrm_Option_Handle wrm_render_loadAndCreateShader(const char *dir, const char *na
     // include slash and .vert
     size_t len = dir_len + 1 + name_len + 5;
     // include null terminator
-    char *vert_path = malloc(len + 1);
-    char *frag_path = malloc(len + 1);
+    char *vert_path = wrm_alloc(wrm_render_allocator, len + 1);
+    char *frag_path = wrm_alloc(wrm_render_allocator, len + 1);
 
     sprintf(vert_path, "%s/%s.vert", dir, name);
     sprintf(frag_path, "%s/%s.frag", dir, name);
@@ -209,12 +252,17 @@ wrm_Option_Handle wrm_render_loadAndCreateShader(const char *dir, const char *na
     char *vert = wrm_readFile(vert_path);
     char *frag = wrm_readFile(frag_path);
 
-    wrm_Option_Handle result; 
-    result = wrm_render_createShader(vert, frag, format);
+    wrm_Option_Handle result = OPTION_NONE(Handle);
+    if(vert && frag) {
+        result = wrm_render_createShader(vert, frag, format);
+    }
+    else if(wrm_render_settings.errors) {
+        wrm_error("Render", "loadAndCreateShader()", "could not read '%s' or '%s'\n", vert_path, frag_path);
+    }
     free(vert);
     free(frag);
-    free(vert_path);
-    free(frag_path);
+    wrm_free(wrm_render_allocator, vert_path, len + 1);
+    wrm_free(wrm_render_allocator, frag_path, len + 1);
     
     return result;
 }
@@ -229,5 +277,59 @@ void wrm_Shader_delete(void *shader)
     glDeleteProgram(s->program);
 }
 
+// file-internal helpers
 
+/* Read the locations of all active uniforms of the linked program once, so that drawing never looks them up by name */
+static void wrm_render_reflectUniforms(wrm_Shader *s)
+{
+    for(u32 u = 0; u < WRM_SHADER_UNIFORM_CNT; u++) { s->uniforms[u] = -1; }
+    s->uniform_cnt = 0;
+
+    GLint active = 0;
+    glGetProgramiv(s->program, GL_ACTIVE_UNIFORMS, &active);
+
+    for(GLint i = 0; i < active; i++) {
+        char name[64];
+        GLsizei len = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(s->program, (GLuint)i, sizeof(name), &len, &size, &type, name);
+
+        // arrays are reported as "name[0]"; look them up by their plain name
+        if(len > 3 && strcmp(name + len - 3, "[0]") == 0) {
+            len -= 3;
+            name[len] = '\0';
+        }
+
+        // uniforms in blocks have no location of their own
+        GLint loc = glGetUniformLocation(s->program, name);
+        if(loc == -1) continue;
+
+        for(u32 u = 0; u < WRM_SHADER_UNIFORM_CNT; u++) {
+            if(strcmp(name, WRM_SHADER_UNIFORM_NAMES[u]) == 0) { s->uniforms[u] = loc; }
+        }
 
+        if(s->uniform_cnt < WRM_SHADER_MAX_UNIFORMS) {
+            s->uniform_hashes[s->uniform_cnt] = wrm_Map_hashBytes(name, (size_t)len);
+            s->uniform_locs[s->uniform_cnt] = loc;
+            s->uniform_cnt++;
+        }
+        else if(wrm_render_settings.errors) {
+            wrm_error("Render", "createShader()", "uniform '%s' is past the %u that can be found by name\n", name, WRM_SHADER_MAX_UNIFORMS);
+        }
+    }
+}
+
+/* Load the instanced variant `name` of default shader `shader`, and link the two; failing only leaves `shader` without one */
+static void wrm_render_addInstancedVariant(const char *shaders_dir, const char *name, wrm_render_Format format, wrm_Handle shader)
+{
+    wrm_Option_Handle result = wrm_render_loadAndCreateShader(shaders_dir, name, format);
+    if(!result.exists) {
+        if(wrm_render_settings.verbose) printf("Render: no instanced variant of shader [%u], its models are drawn one at a time\n", shader);
+        return;
+    }
+
+    // the pool may have moved while creating the variant; a reference notices if the variant is deleted and its slot reused
+    wrm_Shader *s = wrm_Pool_at(&wrm_shaders, shader);
+    s->instanced = wrm_Pool_getRef(&wrm_shaders, result.val);
+}
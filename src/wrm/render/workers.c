@@ -0,0 +1,110 @@
+#include "render.h"
+
+// a worker thread, and the semaphore that starts its part of each job
+typedef struct wrm_render_Worker {
+    SDL_Thread *thread;
+    SDL_sem *start;
+    u32 part; // the calling thread always runs part 0 itself
+} wrm_render_Worker;
+
+static wrm_render_Worker wrm_workers[WRM_RENDER_MAX_WORKERS];
+static u32 wrm_worker_cnt;
+static SDL_sem *wrm_workers_done;
+static bool wrm_workers_quit;
+
+// the job being run; only written while every worker is waiting to start
+static wrm_FUNC(wrm_worker_job, void, void *arg, u32 part);
+static void *wrm_worker_arg;
+
+// file-internal helper declarations
+static int wrm_render_workerMain(void *data);
+
+// module internal
+
+bool wrm_render_initWorkers(void)
+{
+    wrm_worker_cnt = 0;
+    wrm_workers_quit = false;
+
+    // one core is left to the calling thread, which runs its own part of every job
+    int cores = SDL_GetCPUCount() - 1;
+    u32 cnt = cores < 0 ? 0 : (u32)cores;
+    if(cnt > WRM_RENDER_MAX_WORKERS) { cnt = WRM_RENDER_MAX_WORKERS; }
+    if(!cnt) { return true; }
+
+    wrm_workers_done = SDL_CreateSemaphore(0);
+    if(!wrm_workers_done) { return false; }
+
+    // fewer workers than cores only makes jobs slower, so stop at the first that fails
+    for(u32 i = 0; i < cnt; i++) {
+        wrm_render_Worker *w = &wrm_workers[i];
+        w->part = i + 1;
+        w->start = SDL_CreateSemaphore(0);
+        if(!w->start) { break; }
+
+        w->thread = SDL_CreateThread(wrm_render_workerMain, "wrm_render_worker", w);
+        if(!w->thread) {
+            SDL_DestroySemaphore(w->start);
+            break;
+        }
+        wrm_worker_cnt++;
+    }
+
+    if(wrm_render_settings.verbose) printf("Render: started %u worker thread%s\n", wrm_worker_cnt, wrm_worker_cnt == 1 ? "" : "s");
+    return true;
+}
+
+void wrm_render_quitWorkers(void)
+{
+    wrm_workers_quit = true;
+    for(u32 i = 0; i < wrm_worker_cnt; i++) {
+        SDL_SemPost(wrm_workers[i].start);
+    }
+    for(u32 i = 0; i < wrm_worker_cnt; i++) {
+        SDL_WaitThread(wrm_workers[i].thread, NULL);
+        SDL_DestroySemaphore(wrm_workers[i].start);
+        wrm_workers[i] = (wrm_render_Worker){ 0 };
+    }
+    if(wrm_workers_done) { SDL_DestroySemaphore(wrm_workers_done); }
+
+    wrm_workers_done = NULL;
+    wrm_worker_cnt = 0;
+}
+
+u32 wrm_render_workerCount(void)
+{
+    return wrm_worker_cnt + 1;
+}
+
+void wrm_render_runJobs(wrm_FUNC(job, void, void *arg, u32 part), void *arg, u32 parts)
+{
+    if(!parts) { return; }
+    if(parts > wrm_worker_cnt + 1) { parts = wrm_worker_cnt + 1; }
+
+    wrm_worker_job = job;
+    wrm_worker_arg = arg;
+
+    // the semaphores order the writes above before the workers' reads
+    for(u32 i = 0; i + 1 < parts; i++) {
+        SDL_SemPost(wrm_workers[i].start);
+    }
+    job(arg, 0);
+    for(u32 i = 0; i + 1 < parts; i++) {
+        SDL_SemWait(wrm_workers_done);
+    }
+}
+
+// file-internal helpers
+
+static int wrm_render_workerMain(void *data)
+{
+    wrm_render_Worker *w = data;
+
+    while(true) {
+        SDL_SemWait(w->start);
+        if(wrm_workers_quit) { return 0; }
+
+        wrm_worker_job(wrm_worker_arg, w->part);
+        SDL_SemPost(wrm_workers_done);
+    }
+}
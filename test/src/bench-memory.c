@@ -0,0 +1,817 @@
+#define _POSIX_C_SOURCE 199309L
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include "wrm/memory.h"
+
+/*
+Microbenchmarks for the memory module
+
+Each benchmark prints the average time per operation in nanoseconds
+*/
+
+#define BENCH_POOL_CAP 20000
+#define BENCH_ROUNDS 10
+#define BENCH_SPARSE_CAP 100000
+#define BENCH_GROW_CAP (1 << 21)
+#define BENCH_CHURN_LIVE 10000
+#define BENCH_CHURN_OPS 2000000
+#define BENCH_THREAD_OPS 2000000
+#define BENCH_THREAD_LIVE 8
+#define BENCH_TREE_NODES 50000
+#define BENCH_MAP_LOOKUPS 1000000
+#define BENCH_RING_ITEMS 4000000
+#define BENCH_RING_TRIPS 20000
+#define BENCH_SORT_ROUNDS 20
+
+typedef struct Item {
+    float pos[3];
+    u32 id;
+} Item;
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/*
+Reference slot search from before the pool kept a free list: scans `in_use`
+from index 0 for the first open slot
+*/
+static wrm_Option_Handle scanGetSlot(wrm_Pool *p)
+{
+    if(p->used_cnt == p->cap) { return OPTION_NONE(Handle); }
+
+    size_t i = 0;
+    while(wrm_bitAt(p->in_use, i)) { i++; }
+    wrm_bitSet(p->in_use, i, true);
+    p->used_cnt++;
+    memset((u8*)p->data + i * p->e_size, 0, p->e_size);
+    return OPTION_SOME(Handle, i);
+}
+
+static void scanFreeSlot(wrm_Pool *p, wrm_Handle idx)
+{
+    if(!wrm_Pool_isValid(p, idx)) { return; }
+    wrm_bitSet(p->in_use, idx, false);
+    p->used_cnt--;
+}
+
+/*
+Fill the pool, free every other slot, then refill the holes
+`scan` selects the reference linear-scan allocator instead of the free list
+*/
+static void benchFillFreeRefill(bool scan)
+{
+    wrm_Pool p;
+    if(!wrm_Pool_init(&p, BENCH_POOL_CAP, sizeof(Item), false, NULL)) {
+        wrm_fail(1, "Bench", "fill/free/refill", "failed to initialize pool");
+    }
+
+    double fill = 0, release = 0, refill = 0;
+
+    for(int r = 0; r < BENCH_ROUNDS; r++) {
+        double t0 = now_ns();
+        for(u32 i = 0; i < BENCH_POOL_CAP; i++) {
+            if(scan) { scanGetSlot(&p); } else { wrm_Pool_getSlot(&p); }
+        }
+        double t1 = now_ns();
+        for(u32 i = 0; i < BENCH_POOL_CAP; i += 2) {
+            if(scan) { scanFreeSlot(&p, i); } else { wrm_Pool_freeSlot(&p, i); }
+        }
+        double t2 = now_ns();
+        for(u32 i = 0; i < BENCH_POOL_CAP / 2; i++) {
+            if(scan) { scanGetSlot(&p); } else { wrm_Pool_getSlot(&p); }
+        }
+        double t3 = now_ns();
+
+        fill += t1 - t0;
+        release += t2 - t1;
+        refill += t3 - t2;
+
+        // start the next round from an empty pool
+        for(u32 i = 0; i < BENCH_POOL_CAP; i++) {
+            if(scan) { scanFreeSlot(&p, i); } else { wrm_Pool_freeSlot(&p, i); }
+        }
+    }
+
+    double n = (double)BENCH_ROUNDS;
+    printf(
+        "pool %-11s fill: %8.2f ns/op, free: %8.2f ns/op, refill: %8.2f ns/op\n",
+        scan ? "(scan)" : "(free list)",
+        fill / (n * BENCH_POOL_CAP),
+        release / (n * BENCH_POOL_CAP / 2),
+        refill / (n * BENCH_POOL_CAP / 2)
+    );
+
+    wrm_Pool_delete(&p, NULL);
+}
+
+/*
+Walk a pool of `BENCH_SPARSE_CAP` slots with one in every `stride` slots used
+Compares testing every slot with `wrm_Pool_at()` against `wrm_Pool_FOR_EACH`
+*/
+static void benchSparseWalk(u32 stride)
+{
+    wrm_Pool p;
+    if(!wrm_Pool_init(&p, BENCH_SPARSE_CAP, sizeof(Item), false, NULL)) {
+        wrm_fail(1, "Bench", "sparse walk", "failed to initialize pool");
+    }
+    for(u32 i = 0; i < BENCH_SPARSE_CAP; i++) { wrm_Pool_getSlot(&p); }
+    for(u32 i = 0; i < BENCH_SPARSE_CAP; i++) {
+        if(i % stride) { wrm_Pool_freeSlot(&p, i); }
+    }
+
+    volatile u32 sink = 0;
+    double t0 = now_ns();
+    for(int r = 0; r < BENCH_ROUNDS; r++) {
+        for(u32 i = 0; i < p.cap; i++) {
+            Item *item = wrm_Pool_at(&p, i);
+            if(item) { sink += item->id; }
+        }
+    }
+    double t1 = now_ns();
+    for(int r = 0; r < BENCH_ROUNDS; r++) {
+        wrm_Pool_FOR_EACH(&p, i) {
+            sink += wrm_data_AS(p, Item)[i].id;
+        }
+    }
+    double t2 = now_ns();
+
+    printf(
+        "walk 1/%-5u every slot: %8.1f us, for each: %8.1f us\n",
+        stride,
+        (t1 - t0) / (1e3 * BENCH_ROUNDS),
+        (t2 - t1) / (1e3 * BENCH_ROUNDS)
+    );
+
+    wrm_Pool_delete(&p, NULL);
+}
+
+// a model-sized item, so that skipped slots cost cache lines
+typedef struct Big_Item {
+    float transform[16];
+    u32 id;
+} Big_Item;
+
+/*
+Walk pools of `BENCH_SPARSE_CAP` slots with `percent`% of slots used, freed at random
+Compares `wrm_Pool_FOR_EACH` on a normal pool against the packed items of a dense pool
+*/
+static void benchDenseWalk(u32 percent)
+{
+    wrm_Pool sparse, dense;
+    if(!wrm_Pool_init(&sparse, BENCH_SPARSE_CAP, sizeof(Big_Item), false, NULL) ||
+        !wrm_Pool_initDense(&dense, BENCH_SPARSE_CAP, sizeof(Big_Item), false, NULL)
+    ) {
+        wrm_fail(1, "Bench", "dense walk", "failed to initialize pools");
+    }
+    for(u32 i = 0; i < BENCH_SPARSE_CAP; i++) {
+        wrm_Pool_getSlot(&sparse);
+        wrm_Pool_getSlot(&dense);
+    }
+    srand(1);
+    for(u32 i = 0; i < BENCH_SPARSE_CAP; i++) {
+        if((u32)(rand() % 100) >= percent) {
+            wrm_Pool_freeSlot(&sparse, i);
+            wrm_Pool_freeSlot(&dense, i);
+        }
+    }
+
+    volatile u32 sink = 0;
+    double t0 = now_ns();
+    for(int r = 0; r < BENCH_ROUNDS; r++) {
+        wrm_Pool_FOR_EACH(&sparse, i) {
+            sink += wrm_data_AS(sparse, Big_Item)[i].id;
+        }
+    }
+    double t1 = now_ns();
+    for(int r = 0; r < BENCH_ROUNDS; r++) {
+        for(u32 pos = 0; pos < dense.used_cnt; pos++) {
+            sink += ((Big_Item*)wrm_Pool_packedAt(&dense, pos))->id;
+        }
+    }
+    double t2 = now_ns();
+
+    printf(
+        "walk %3u%% used  for each: %8.1f us, dense: %8.1f us\n",
+        percent,
+        (t1 - t0) / (1e3 * BENCH_ROUNDS),
+        (t2 - t1) / (1e3 * BENCH_ROUNDS)
+    );
+
+    wrm_Pool_delete(&sparse, NULL);
+    wrm_Pool_delete(&dense, NULL);
+}
+
+typedef struct Scene_Node {
+    wrm_Tree_Node node;
+    float local[16]; // stands in for a transform
+    float world;
+} Scene_Node;
+
+/* Accumulate world values down the subtree under `idx` by recursion, as the renderer used to */
+static void treeWalkRecursive(wrm_Tree *tree, u32 idx, float parent)
+{
+    Scene_Node *n = wrm_Pool_at(tree->src, idx);
+    n->world = parent + n->local[0];
+    wrm_Tree_FOR_EACH_CHILD(tree, &n->node, c) {
+        treeWalkRecursive(tree, c, n->world);
+    }
+}
+
+/*
+Propagate a value from the roots of a `BENCH_TREE_NODES`-node tree to every node,
+each node a child of a random earlier node up to `fan_out` children each, with
+slots shuffled so the hierarchy does not follow memory order
+Compares the recursive walk against a forward loop over the flattened tree
+*/
+static void benchTreeWalk(u32 fan_out)
+{
+    wrm_Pool p;
+    wrm_Tree tree;
+    if(!wrm_Pool_init(&p, BENCH_TREE_NODES, sizeof(Scene_Node), false, NULL) ||
+        !wrm_Tree_initFlat(&tree, &p, offsetof(Scene_Node, node), NULL)
+    ) {
+        wrm_fail(1, "Bench", "tree walk", "failed to initialize pool and tree");
+    }
+    for(u32 i = 0; i < BENCH_TREE_NODES; i++) {
+        wrm_Pool_getSlot(&p);
+        wrm_data_AS(p, Scene_Node)[i].local[0] = 1.0f;
+    }
+
+    u32 *slots = malloc(BENCH_TREE_NODES * sizeof(u32));
+    srand(1);
+    for(u32 i = 0; i < BENCH_TREE_NODES; i++) { slots[i] = i; }
+    for(u32 i = BENCH_TREE_NODES - 1; i > 0; i--) {
+        u32 j = (u32)rand() % (i + 1);
+        u32 tmp = slots[i]; slots[i] = slots[j]; slots[j] = tmp;
+    }
+    for(u32 i = 1; i < BENCH_TREE_NODES; i++) {
+        u32 parent = slots[(u32)rand() % i];
+        if(wrm_Tree_at(&tree, parent)->child_cnt < fan_out) { wrm_Tree_addChild(&tree, parent, slots[i]); }
+    }
+    free(slots);
+
+    double t0 = now_ns();
+    for(int r = 0; r < BENCH_ROUNDS; r++) {
+        wrm_Pool_FOR_EACH(&p, i) {
+            if(!wrm_Tree_at(&tree, i)->has_parent) { treeWalkRecursive(&tree, i, 0.0f); }
+        }
+    }
+    double t1 = now_ns();
+    wrm_Tree_flatten(&tree);
+    double t2 = now_ns();
+    float *world = malloc(BENCH_TREE_NODES * sizeof(float));
+    for(int r = 0; r < BENCH_ROUNDS; r++) {
+        wrm_Tree_flatten(&tree); // current, so this returns at once
+        for(u32 pos = 0; pos < tree.flat_len; pos++) {
+            Scene_Node *n = wrm_Pool_slotData(&p, tree.order[pos]);
+            u32 parent = tree.parent_pos[pos];
+            world[pos] = (parent == WRM_POOL_NO_SLOT ? 0.0f : world[parent]) + n->local[0];
+            n->world = world[pos];
+        }
+    }
+    double t3 = now_ns();
+    free(world);
+
+    printf(
+        "fan-out %4u  recursive: %8.1f us, flat: %8.1f us (flatten: %8.1f us)\n",
+        fan_out,
+        (t1 - t0) / (1e3 * BENCH_ROUNDS),
+        (t3 - t2) / (1e3 * BENCH_ROUNDS),
+        (t2 - t1) / 1e3
+    );
+
+    wrm_Tree_delete(&tree);
+    wrm_Pool_delete(&p, NULL);
+}
+
+// hot and cold halves of a model, split for a structure-of-arrays pool
+typedef struct Transform {
+    float pos[3];
+    float rot[3];
+    float scale[3];
+} Transform;
+
+typedef struct Resources {
+    wrm_Ref mesh;
+    wrm_Ref texture;
+    wrm_Ref shader;
+    wrm_Tree_Node tree_node;
+    bool children_shown;
+} Resources;
+
+// the same fields laid out like `wrm_Model`
+typedef struct Model_Item {
+    Transform transform;
+    Resources resources;
+    bool shown;
+} Model_Item;
+
+/*
+Move every shown model of `BENCH_SPARSE_CAP`, as the per-frame transform pass does
+Compares an array-of-structs pool against a structure-of-arrays pool that keeps
+the transforms and visibility flags apart from the resource handles
+*/
+static void benchSoaTransform(void)
+{
+    enum { FIELD_TRANSFORM, FIELD_SHOWN, FIELD_RESOURCES };
+    const size_t sizes[] = { sizeof(Transform), sizeof(bool), sizeof(Resources) };
+    wrm_Pool aos;
+    wrm_Soa_Pool soa;
+    if(!wrm_Pool_init(&aos, BENCH_SPARSE_CAP, sizeof(Model_Item), false, NULL) ||
+        !wrm_Soa_Pool_init(&soa, BENCH_SPARSE_CAP, sizes, 3, false, NULL)
+    ) {
+        wrm_fail(1, "Bench", "SoA transform", "failed to initialize pools");
+    }
+    for(u32 i = 0; i < BENCH_SPARSE_CAP; i++) {
+        wrm_Pool_getSlot(&aos);
+        wrm_Soa_Pool_getSlot(&soa);
+        wrm_data_AS(aos, Model_Item)[i].shown = i % 8 != 0;
+        wrm_Soa_Pool_ARRAY(&soa, FIELD_SHOWN, bool)[i] = i % 8 != 0;
+    }
+
+    double t0 = now_ns();
+    for(int r = 0; r < BENCH_ROUNDS; r++) {
+        Model_Item *items = aos.data;
+        for(u32 i = 0; i < aos.top; i++) {
+            if(!items[i].shown) { continue; }
+            for(u32 k = 0; k < 3; k++) { items[i].transform.pos[k] += 0.5f * items[i].transform.scale[k]; }
+        }
+    }
+    double t1 = now_ns();
+    for(int r = 0; r < BENCH_ROUNDS; r++) {
+        Transform *transforms = wrm_Soa_Pool_ARRAY(&soa, FIELD_TRANSFORM, Transform);
+        bool *shown = wrm_Soa_Pool_ARRAY(&soa, FIELD_SHOWN, bool);
+        for(u32 i = 0; i < soa.slots.top; i++) {
+            if(!shown[i]) { continue; }
+            for(u32 k = 0; k < 3; k++) { transforms[i].pos[k] += 0.5f * transforms[i].scale[k]; }
+        }
+    }
+    double t2 = now_ns();
+
+    printf(
+        "transform pass  AoS (%zu bytes): %8.1f us, SoA (%zu + %zu hot bytes): %8.1f us\n",
+        sizeof(Model_Item),
+        (t1 - t0) / (1e3 * BENCH_ROUNDS),
+        sizeof(Transform),
+        sizeof(bool),
+        (t2 - t1) / (1e3 * BENCH_ROUNDS)
+    );
+
+    wrm_Pool_delete(&aos, NULL);
+    wrm_Soa_Pool_delete(&soa);
+}
+
+// laid out like the renderer's draw list entries
+typedef struct Draw_Item {
+    float transform[16];
+    u32 mesh;
+    u32 shader;
+    u32 texture;
+    u32 src_model;
+    float distance;
+    bool transparent;
+} Draw_Item;
+
+/* Draw order as the renderer's comparison function had it, with ties returning 0 */
+static int compareDraws(const void *a, const void *b)
+{
+    const Draw_Item *d1 = a;
+    const Draw_Item *d2 = b;
+
+    if(d1->transparent != d2->transparent) { return d1->transparent ? 1 : -1; }
+    if(d1->transparent && d1->distance != d2->distance) { return d1->distance < d2->distance ? 1 : -1; }
+    if(d1->shader != d2->shader) { return d1->shader < d2->shader ? -1 : 1; }
+    if(d1->texture != d2->texture) { return d1->texture < d2->texture ? -1 : 1; }
+    if(d1->mesh != d2->mesh) { return d1->mesh < d2->mesh ? -1 : 1; }
+    return 0;
+}
+
+/* Pack a draw into a 64-bit key as the renderer does */
+static u64 drawKey(const Draw_Item *d)
+{
+    float depth = d->distance / 1000.0f;
+    if(!d->transparent) {
+        return ((u64)d->shader << 47) | ((u64)d->texture << 31) | ((u64)d->mesh << 15) | (u64)(depth * 0x7FFF);
+    }
+    u64 q = 0xFFFFFF - (u64)(depth * 0xFFFFFF);
+    return ((u64)1 << 63) | (q << 39) | ((u64)d->shader << 26) | ((u64)d->texture << 13) | (u64)d->mesh;
+}
+
+/*
+Sort a draw list of `draws` entries (8 shaders, 32 textures, 64 meshes, 1 in 5 transparent)
+Compares qsort() moving the entries through a comparison function against
+packing 64-bit keys and radix sorting key/index pairs
+*/
+static void benchDrawSort(u32 draws)
+{
+    Draw_Item *items = malloc(draws * sizeof(Draw_Item));
+    Draw_Item *sorted = malloc(draws * sizeof(Draw_Item));
+    wrm_Sort_Key *keys = malloc(draws * sizeof(wrm_Sort_Key));
+    wrm_Sort_Key *tmp = malloc(draws * sizeof(wrm_Sort_Key));
+    if(!items || !sorted || !keys || !tmp) { wrm_fail(1, "Bench", "draw sort", "failed to allocate draws"); }
+
+    srand(1);
+    for(u32 i = 0; i < draws; i++) {
+        items[i] = (Draw_Item){
+            .shader = (u32)rand() % 8,
+            .texture = (u32)rand() % 32,
+            .mesh = (u32)rand() % 64,
+            .src_model = i,
+            .distance = (float)(rand() % 100000) / 100.0f,
+            .transparent = rand() % 5 == 0
+        };
+    }
+
+    double qsort_ns = 0, radix_ns = 0;
+    for(int r = 0; r < BENCH_SORT_ROUNDS; r++) {
+        memcpy(sorted, items, draws * sizeof(Draw_Item));
+        double t0 = now_ns();
+        qsort(sorted, draws, sizeof(Draw_Item), compareDraws);
+        double t1 = now_ns();
+        for(u32 i = 0; i < draws; i++) { keys[i] = (wrm_Sort_Key){ .key = drawKey(&items[i]), .idx = i }; }
+        wrm_radixSort(keys, tmp, draws);
+        double t2 = now_ns();
+        qsort_ns += t1 - t0;
+        radix_ns += t2 - t1;
+    }
+
+    for(u32 i = 1; i < draws; i++) {
+        if(keys[i - 1].key > keys[i].key) { wrm_fail(1, "Bench", "draw sort", "keys out of order at %u", i); }
+    }
+
+    printf(
+        "%6u draws  qsort: %8.1f us, radix keys: %8.1f us\n",
+        draws,
+        qsort_ns / (1e3 * BENCH_SORT_ROUNDS),
+        radix_ns / (1e3 * BENCH_SORT_ROUNDS)
+    );
+
+    free(items);
+    free(sorted);
+    free(keys);
+    free(tmp);
+}
+
+/*
+Look up random keys, half of them missing, among `entries` u64 -> u32 entries
+Compares a linear search of a key array (as `wrm_cstr_match()` does) against a map
+*/
+static void benchMapLookup(u32 entries)
+{
+    wrm_Map m;
+    u64 *keys = malloc(entries * sizeof(u64));
+    u64 *probes = malloc(BENCH_MAP_LOOKUPS * sizeof(u64));
+    if(!keys || !probes || !wrm_Map_init(&m, entries, sizeof(u64), sizeof(u32), NULL, NULL, NULL)) {
+        wrm_fail(1, "Bench", "map lookup", "failed to initialize map");
+    }
+
+    srand(1);
+    for(u32 i = 0; i < entries; i++) {
+        keys[i] = ((u64)rand() << 32 | (u64)rand()) * 2; // even keys are put, odd ones are missing
+        wrm_Map_put(&m, &keys[i], &i);
+    }
+    for(u32 i = 0; i < BENCH_MAP_LOOKUPS; i++) {
+        probes[i] = keys[(u32)rand() % entries] + (u64)(rand() & 1);
+    }
+
+    // a linear search of a big array is slow, so it gets fewer lookups
+    u32 linear_lookups = BENCH_MAP_LOOKUPS / (entries > 1024 ? 1000 : 1);
+    volatile u32 sink = 0;
+    double t0 = now_ns();
+    for(u32 i = 0; i < linear_lookups; i++) {
+        for(u32 j = 0; j < entries; j++) {
+            if(keys[j] == probes[i]) { sink += j; break; }
+        }
+    }
+    double t1 = now_ns();
+    for(u32 i = 0; i < BENCH_MAP_LOOKUPS; i++) {
+        u32 *v = wrm_Map_get(&m, &probes[i]);
+        if(v) { sink += *v; }
+    }
+    double t2 = now_ns();
+
+    printf(
+        "%6u entries  linear: %10.1f ns/lookup, map: %6.1f ns/lookup (%zu slots)\n",
+        entries,
+        (t1 - t0) / linear_lookups,
+        (t2 - t1) / BENCH_MAP_LOOKUPS,
+        m.cap
+    );
+
+    wrm_Map_delete(&m);
+    free(keys);
+    free(probes);
+}
+
+/*
+Grow a pool one slot at a time from empty to `BENCH_GROW_CAP` slots
+Reports the average and the worst single `wrm_Pool_getSlot()`, which is the
+frame hitch a reallocating pool causes when it copies everything to grow
+*/
+static void benchGrowth(bool virtual)
+{
+    wrm_Pool p;
+    bool ok = virtual
+        ? wrm_Pool_initVirtual(&p, 0, BENCH_GROW_CAP, sizeof(Big_Item), NULL)
+        : wrm_Pool_init(&p, 0, sizeof(Big_Item), true, NULL);
+    if(!ok) {
+        wrm_fail(1, "Bench", "growth", "failed to initialize pool");
+    }
+
+    double worst = 0;
+    double t0 = now_ns();
+    for(u32 i = 0; i < BENCH_GROW_CAP; i++) {
+        double t = now_ns();
+        wrm_Pool_getSlot(&p);
+        t = now_ns() - t;
+        if(t > worst) { worst = t; }
+    }
+    double t1 = now_ns();
+
+    printf(
+        "grow %-9s avg: %8.2f ns/op, worst: %8.1f us\n",
+        virtual ? "(virtual)" : "(realloc)",
+        (t1 - t0) / BENCH_GROW_CAP,
+        worst / 1e3
+    );
+
+    wrm_Pool_delete(&p, NULL);
+}
+
+enum { CHURN_MALLOC, CHURN_CALLOC, CHURN_SLAB };
+
+/*
+Keep `BENCH_CHURN_LIVE` small objects of mixed sizes (1 byte to 2 KiB, mostly
+small) alive, replacing a random one `BENCH_CHURN_OPS` times
+Compares glibc malloc() and calloc() against the slab allocator, which like
+calloc() returns zeroed memory
+*/
+static void benchChurn(int source)
+{
+    static void *live[BENCH_CHURN_LIVE];
+    static u32 sizes[BENCH_CHURN_LIVE];
+    wrm_Slab_Allocator slab;
+    wrm_Slab_Allocator_init(&slab, NULL);
+
+    srand(2);
+    double t0 = now_ns();
+    for(u32 op = 0; op < BENCH_CHURN_OPS + BENCH_CHURN_LIVE; op++) {
+        u32 i = op < BENCH_CHURN_LIVE ? op : (u32)rand() % BENCH_CHURN_LIVE;
+        if(op >= BENCH_CHURN_LIVE) {
+            if(source == CHURN_SLAB) { wrm_free(&slab.allocator, live[i], sizes[i]); }
+            else { free(live[i]); }
+        }
+
+        u32 size = (8u << ((u32)rand() % 6 + ((u32)rand() % 4 == 0) * 3)) - (u32)rand() % 8;
+        sizes[i] = size;
+        switch(source) {
+            case CHURN_MALLOC: live[i] = malloc(size); break;
+            case CHURN_CALLOC: live[i] = calloc(1, size); break;
+            default: live[i] = wrm_alloc(&slab.allocator, size); break;
+        }
+        *(volatile u8*)live[i] = 1;
+    }
+    double t1 = now_ns();
+
+    size_t live_bytes = 0;
+    for(u32 i = 0; i < BENCH_CHURN_LIVE; i++) {
+        live_bytes += sizes[i];
+        if(source == CHURN_SLAB) { wrm_free(&slab.allocator, live[i], sizes[i]); }
+        else { free(live[i]); }
+    }
+
+    const char *names[] = { "(malloc)", "(calloc)", "(slab)" };
+    printf("churn %-9s %8.2f ns/op", names[source], (t1 - t0) / (BENCH_CHURN_OPS + BENCH_CHURN_LIVE));
+    if(source == CHURN_SLAB) {
+        printf(", %zu KiB in slabs for %zu KiB live", slab.slab_cnt * WRM_SLAB_BYTES / 1024, live_bytes / 1024);
+    }
+    printf("\n");
+
+    wrm_Slab_Allocator_delete(&slab);
+}
+
+static wrm_Concurrent_Pool bench_concurrent;
+static wrm_Pool bench_locked;
+static pthread_mutex_t bench_lock = PTHREAD_MUTEX_INITIALIZER;
+static u32 bench_threads;
+
+/* Take and free slots, keeping a few live, sharing the work among `bench_threads` threads */
+static void *benchConcurrentThread(void *arg)
+{
+    bool locked = arg;
+    wrm_Ref live[BENCH_THREAD_LIVE];
+    wrm_Handle live_idx[BENCH_THREAD_LIVE];
+
+    for(u32 i = 0; i < BENCH_THREAD_OPS / bench_threads / BENCH_THREAD_LIVE; i++) {
+        for(u32 j = 0; j < BENCH_THREAD_LIVE; j++) {
+            if(locked) {
+                pthread_mutex_lock(&bench_lock);
+                live_idx[j] = wrm_Pool_getSlot(&bench_locked).val;
+                pthread_mutex_unlock(&bench_lock);
+            }
+            else { live[j] = wrm_Concurrent_Pool_getSlot(&bench_concurrent).val; }
+        }
+        for(u32 j = 0; j < BENCH_THREAD_LIVE; j++) {
+            if(locked) {
+                pthread_mutex_lock(&bench_lock);
+                wrm_Pool_freeSlot(&bench_locked, live_idx[j]);
+                pthread_mutex_unlock(&bench_lock);
+            }
+            else { wrm_Concurrent_Pool_freeSlot(&bench_concurrent, live[j]); }
+        }
+    }
+    return NULL;
+}
+
+/*
+Throughput of getting and freeing slots from `threads` threads at once
+Compares the lock-free concurrent pool against a normal pool behind a mutex
+*/
+static void benchConcurrent(u32 threads)
+{
+    size_t cap = (size_t)threads * BENCH_THREAD_LIVE;
+    if(!wrm_Concurrent_Pool_init(&bench_concurrent, cap, sizeof(Item), NULL) ||
+        !wrm_Pool_init(&bench_locked, cap, sizeof(Item), false, NULL)
+    ) {
+        wrm_fail(1, "Bench", "concurrent", "failed to initialize pools");
+    }
+    bench_threads = threads;
+
+    double ns[2];
+    pthread_t ids[16];
+    for(int locked = 0; locked < 2; locked++) {
+        double t0 = now_ns();
+        for(u32 i = 0; i < threads; i++) {
+            pthread_create(&ids[i], NULL, benchConcurrentThread, locked ? (void*)1 : NULL);
+        }
+        for(u32 i = 0; i < threads; i++) {
+            pthread_join(ids[i], NULL);
+        }
+        ns[locked] = now_ns() - t0;
+    }
+
+    printf(
+        "%2u thread%s lock-free: %6.1f Mops/s, mutex: %6.1f Mops/s\n",
+        threads, threads == 1 ? " " : "s",
+        2.0 * BENCH_THREAD_OPS / ns[0] * 1e3,
+        2.0 * BENCH_THREAD_OPS / ns[1] * 1e3
+    );
+
+    wrm_Concurrent_Pool_delete(&bench_concurrent);
+    wrm_Pool_delete(&bench_locked, NULL);
+}
+
+static wrm_Ring bench_ring;
+static wrm_Ring bench_echo;
+static u32 bench_batch;
+
+/* Push this thread's share of `BENCH_RING_ITEMS` in batches of `bench_batch`, waiting while the ring is full */
+static void *benchRingProducer(void *arg)
+{
+    u32 producers = (u32)(uintptr_t)arg;
+    u64 batch[64] = { 0 };
+    for(u32 sent = 0; sent < BENCH_RING_ITEMS / producers; ) {
+        size_t n = wrm_Ring_push(&bench_ring, batch, bench_batch);
+        if(!n) { sched_yield(); }
+        sent += (u32)n;
+    }
+    return NULL;
+}
+
+/*
+Move `BENCH_RING_ITEMS` 8-byte items from `producers` threads to this one, `batch` at a time
+Reports items per second through the ring
+*/
+static void benchRingThroughput(u32 producers, u32 batch)
+{
+    if(!wrm_Ring_init(&bench_ring, 4096, sizeof(u64), producers > 1, NULL)) {
+        wrm_fail(1, "Bench", "ring", "failed to initialize ring");
+    }
+    bench_batch = batch;
+
+    pthread_t ids[8];
+    double t0 = now_ns();
+    for(u32 i = 0; i < producers; i++) {
+        pthread_create(&ids[i], NULL, benchRingProducer, (void*)(uintptr_t)producers);
+    }
+    u64 items[64];
+    for(u32 received = 0; received < BENCH_RING_ITEMS / producers * producers; ) {
+        size_t n = wrm_Ring_pop(&bench_ring, items, batch);
+        if(!n) { sched_yield(); }
+        received += (u32)n;
+    }
+    for(u32 i = 0; i < producers; i++) {
+        pthread_join(ids[i], NULL);
+    }
+    double t1 = now_ns();
+
+    printf(
+        "%s %u producer%s, batch %2u: %7.1f Mitems/s\n",
+        producers > 1 ? "MPSC" : "SPSC", producers, producers == 1 ? " " : "s", batch,
+        BENCH_RING_ITEMS / (t1 - t0) * 1e3
+    );
+    wrm_Ring_delete(&bench_ring);
+}
+
+/* Send every item that arrives on `bench_ring` straight back on `bench_echo` */
+static void *benchRingEcho(void *arg)
+{
+    (void)arg;
+    for(u32 i = 0; i < BENCH_RING_TRIPS; i++) {
+        u64 item;
+        while(!wrm_Ring_pop(&bench_ring, &item, 1)) { sched_yield(); }
+        wrm_Ring_push(&bench_echo, &item, 1);
+    }
+    return NULL;
+}
+
+/* Bounce single items between two threads over a pair of rings; reports the average round trip */
+static void benchRingLatency(void)
+{
+    if(!wrm_Ring_init(&bench_ring, 64, sizeof(u64), false, NULL) || !wrm_Ring_init(&bench_echo, 64, sizeof(u64), false, NULL)) {
+        wrm_fail(1, "Bench", "ring", "failed to initialize rings");
+    }
+
+    pthread_t echo;
+    pthread_create(&echo, NULL, benchRingEcho, NULL);
+    double t0 = now_ns();
+    for(u64 i = 0; i < BENCH_RING_TRIPS; i++) {
+        u64 item = i;
+        wrm_Ring_push(&bench_ring, &item, 1);
+        while(!wrm_Ring_pop(&bench_echo, &item, 1)) { sched_yield(); }
+        if(item != i) { wrm_fail(1, "Bench", "ring", "echo returned the wrong item"); }
+    }
+    double t1 = now_ns();
+    pthread_join(echo, NULL);
+
+    printf("round trip: %8.1f ns\n", (t1 - t0) / BENCH_RING_TRIPS);
+    wrm_Ring_delete(&bench_ring);
+    wrm_Ring_delete(&bench_echo);
+}
+
+int main(void)
+{
+    printf("Pool slot allocation (%d slots, %d rounds):\n", BENCH_POOL_CAP, BENCH_ROUNDS);
+    benchFillFreeRefill(true);
+    benchFillFreeRefill(false);
+
+    printf("\nSparse pool walk (%d slots):\n", BENCH_SPARSE_CAP);
+    benchSparseWalk(2);
+    benchSparseWalk(16);
+    benchSparseWalk(100);
+    benchSparseWalk(1000);
+
+    printf("\nDense pool walk (%d slots of %zu bytes):\n", BENCH_SPARSE_CAP, sizeof(Big_Item));
+    benchDenseWalk(10);
+    benchDenseWalk(50);
+    benchDenseWalk(90);
+
+    printf("\nModel transform pass (%d models, 1 in 8 hidden):\n", BENCH_SPARSE_CAP);
+    benchSoaTransform();
+
+    printf("\nDraw list sort (%zu-byte entries):\n", sizeof(Draw_Item));
+    benchDrawSort(1000);
+    benchDrawSort(10000);
+    benchDrawSort(100000);
+
+    printf("\nTree walk (%d nodes):\n", BENCH_TREE_NODES);
+    benchTreeWalk(4);
+    benchTreeWalk(64);
+    benchTreeWalk(1024);
+
+    printf("\nMap lookup (%d lookups, half of them missing):\n", BENCH_MAP_LOOKUPS);
+    benchMapLookup(16);
+    benchMapLookup(256);
+    benchMapLookup(65536);
+
+    printf("\nPool growth (to %d slots of %zu bytes):\n", BENCH_GROW_CAP, sizeof(Big_Item));
+    benchGrowth(false);
+    benchGrowth(true);
+
+    printf("\nSmall object churn (%d live, %d replacements):\n", BENCH_CHURN_LIVE, BENCH_CHURN_OPS);
+    benchChurn(CHURN_MALLOC);
+    benchChurn(CHURN_CALLOC);
+    benchChurn(CHURN_SLAB);
+
+    printf("\nConcurrent pool get + free (%d pairs in total):\n", BENCH_THREAD_OPS);
+    benchConcurrent(1);
+    benchConcurrent(4);
+    benchConcurrent(8);
+    benchConcurrent(16);
+
+    printf("\nRing throughput (%d items of 8 bytes):\n", BENCH_RING_ITEMS);
+    benchRingThroughput(1, 1);
+    benchRingThroughput(1, 64);
+    benchRingThroughput(4, 1);
+    benchRingThroughput(4, 64);
+
+    printf("\nRing latency (%d round trips between two threads):\n", BENCH_RING_TRIPS);
+    benchRingLatency();
+
+    return 0;
+}
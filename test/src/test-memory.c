@@ -1,9 +1,112 @@
+#include <pthread.h>
 #include "wrm/memory.h"
 
 typedef struct Test {
     wrm_Tree_Node node;
 } Test;
 
+typedef struct Linked {
+    wrm_Tree_Node node;
+    u32 value;
+    u32 buddy; // slot of another item in the same pool
+} Linked;
+
+#define STRESS_THREADS 8
+#define STRESS_ITERATIONS 200000
+#define STRESS_LIVE 16
+#define STRESS_CAP (STRESS_THREADS * STRESS_LIVE)
+
+typedef struct Stress_Item {
+    u32 thread;
+    u32 iteration;
+} Stress_Item;
+
+static wrm_Concurrent_Pool stress_pool;
+
+/* Take and free slots as fast as possible, checking no other thread was handed the same one */
+static void *stressThread(void *arg)
+{
+    u32 thread = (u32)(uintptr_t)arg;
+    wrm_Ref live[STRESS_LIVE];
+    u32 live_cnt = 0;
+
+    for(u32 i = 0; i < STRESS_ITERATIONS; i++) {
+        if(live_cnt == STRESS_LIVE || (live_cnt && (i * 2654435761u) >> 31)) {
+            wrm_Ref ref = live[--live_cnt];
+            Stress_Item *item = wrm_Concurrent_Pool_deref(&stress_pool, ref);
+            if(!item || item->thread != thread) wrm_fail(1, "Test", "concurrent pool", "slot %u was handed to two threads", ref.idx);
+            if(!wrm_Concurrent_Pool_freeSlot(&stress_pool, ref)) wrm_fail(1, "Test", "concurrent pool", "failed to free slot %u", ref.idx);
+            if(wrm_Concurrent_Pool_freeSlot(&stress_pool, ref)) wrm_fail(1, "Test", "concurrent pool", "freed slot %u twice", ref.idx);
+            continue;
+        }
+        wrm_Option_Ref result = wrm_Concurrent_Pool_getSlot(&stress_pool);
+        if(!result.exists) wrm_fail(1, "Test", "concurrent pool", "ran out of slots");
+        Stress_Item *item = wrm_Concurrent_Pool_deref(&stress_pool, result.val);
+        if(item->thread || item->iteration) wrm_fail(1, "Test", "concurrent pool", "slot %u was not zeroed", result.val.idx);
+        *item = (Stress_Item){ .thread = thread, .iteration = i };
+        live[live_cnt++] = result.val;
+    }
+    while(live_cnt) { wrm_Concurrent_Pool_freeSlot(&stress_pool, live[--live_cnt]); }
+    return NULL;
+}
+
+#define RING_PRODUCERS 4
+#define RING_ITEMS 100000
+
+static wrm_Ring stress_ring;
+
+/* Send `RING_ITEMS` numbered items, alternating batch pushes with writes in place */
+static void *ringProducer(void *arg)
+{
+    u32 thread = (u32)(uintptr_t)arg;
+    u32 i = 0;
+
+    while(i < RING_ITEMS) {
+        if(i & 64) {
+            Stress_Item batch[7];
+            u32 n = RING_ITEMS - i < 7 ? RING_ITEMS - i : 7;
+            for(u32 j = 0; j < n; j++) { batch[j] = (Stress_Item){ .thread = thread, .iteration = i + j }; }
+            i += (u32)wrm_Ring_push(&stress_ring, batch, n);
+        }
+        else {
+            wrm_Ring_Span span = wrm_Ring_reserve(&stress_ring, RING_ITEMS - i);
+            Stress_Item *items = (Stress_Item*)span.data;
+            for(size_t j = 0; j < span.cnt; j++) { items[j] = (Stress_Item){ .thread = thread, .iteration = i++ }; }
+            wrm_Ring_commit(&stress_ring, span);
+        }
+    }
+    return NULL;
+}
+
+/* Run `producers` threads into the ring and check every item arrives once, in order per producer */
+static void ringStress(u32 producers)
+{
+    if(!wrm_Ring_init(&stress_ring, 1000, sizeof(Stress_Item), producers > 1, NULL) || stress_ring.cap != 1024) {
+        wrm_fail(1, "Test", "ring", "failed to initialize ring");
+    }
+    pthread_t threads[RING_PRODUCERS];
+    for(u32 i = 0; i < producers; i++) {
+        pthread_create(&threads[i], NULL, ringProducer, (void*)(uintptr_t)i);
+    }
+
+    u32 next[RING_PRODUCERS] = { 0 };
+    for(u32 received = 0; received < producers * RING_ITEMS; ) {
+        Stress_Item items[13];
+        size_t n = wrm_Ring_pop(&stress_ring, items, 13);
+        for(size_t j = 0; j < n; j++) {
+            if(items[j].thread >= producers || items[j].iteration != next[items[j].thread]++) {
+                wrm_fail(1, "Test", "ring", "item %u from producer %u arrived out of order", items[j].iteration, items[j].thread);
+            }
+        }
+        received += (u32)n;
+    }
+    for(u32 i = 0; i < producers; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    if(wrm_Ring_len(&stress_ring) != 0) wrm_fail(1, "Test", "ring", "items left over");
+    wrm_Ring_delete(&stress_ring);
+}
+
 void printChildren(wrm_Handle idx, Test *test, wrm_Tree *tree)
 {
     if(!test) { return; }
@@ -15,26 +118,89 @@ void printChildren(wrm_Handle idx, Test *test, wrm_Tree *tree)
     }
     printf("child_cnt: %u", test->node.child_cnt);
     if(test->node.child_cnt > 0) {
-       printf(", children: %u", test->node.children);
-    }
-    if(test->node.child_cnt > 1) {
-        u32 *children = wrm_Pool_at(&tree->child_lists, test->node.children);
-        printf("{ ");
-        for(u8 i = 0; i < test->node.child_cnt; i++) {
-            printf("%u ", children[i]);
+        printf(", children: { ");
+        wrm_Tree_FOR_EACH_CHILD(tree, &test->node, c) {
+            printf("%u ", c);
         }
         printf("}");
     }
     printf(" }\n");
 }
 
+typedef struct Visit_Log {
+    u32 entered[16];
+    u32 left[16];
+    u32 depths[16];
+    u32 enter_cnt;
+    u32 leave_cnt;
+    u32 prune; // node whose children are skipped
+} Visit_Log;
+
+bool visitEnter(void *ctx, u32 node, u32 depth)
+{
+    Visit_Log *log = ctx;
+    log->depths[log->enter_cnt] = depth;
+    log->entered[log->enter_cnt++] = node;
+    return node != log->prune;
+}
+
+void visitLeave(void *ctx, u32 node, u32 depth)
+{
+    (void)depth;
+    Visit_Log *log = ctx;
+    log->left[log->leave_cnt++] = node;
+}
+
+// heap allocations that fail once `budget` bytes would be live
+typedef struct Budget {
+    size_t budget;
+    size_t used;
+} Budget;
+
+void *budgetAlloc(void *ctx, size_t size)
+{
+    Budget *b = ctx;
+    if(b->used + size > b->budget) { return NULL; }
+    b->used += size;
+    return calloc(1, size);
+}
+
+void *budgetRealloc(void *ctx, void *ptr, size_t old_size, size_t new_size)
+{
+    Budget *b = ctx;
+    if(b->used - old_size + new_size > b->budget) { return NULL; }
+    void *temp = realloc(ptr, new_size);
+    if(temp) { b->used = b->used - old_size + new_size; }
+    return temp;
+}
+
+void budgetFree(void *ctx, void *ptr, size_t size)
+{
+    Budget *b = ctx;
+    b->used -= size;
+    free(ptr);
+}
+
+// checks that field 1 of a SoA pool was moved along with field 0 before this hook runs
+void soaCheckHook(void *ctx, const u32 *remap, size_t len)
+{
+    (void)remap;
+    (void)len;
+    wrm_Soa_Pool *s = ctx;
+    wrm_Soa_Pool_FOR_EACH(s, i) {
+        if(wrm_Soa_Pool_ARRAY(s, 1, u32)[i] != wrm_Soa_Pool_ARRAY(s, 0, u32)[i]) {
+            wrm_fail(1, "Test", "SoA pool", "remap hook saw field 1 before it moved, at %u", i);
+        }
+    }
+}
+
 int main(int argv, char **argc)
 {
         
     wrm_Pool p;
     wrm_Stack s;
     
-    if(!wrm_Pool_init(&p, 20, sizeof(Test), false) || !wrm_Stack_init(&s, 20, sizeof(Test), false)) {
+    if(!wrm_Pool_init(&p, 20, sizeof(Test), false, NULL) || !wrm_Stack_init(&s, 20, sizeof(Test), false, NULL)) {
         wrm_fail(1, "Test", "start", "failed to initialize stack and pool");
     }
     
@@ -73,7 +239,7 @@ int main(int argv, char **argc)
 
     if(p.in_use || p.data || s.data) wrm_fail(1, "Test", "delete", "stack and pool not properly deleted");
 
-    if(!wrm_Pool_init(&p, 20, sizeof(Test), true) || !wrm_Stack_init(&s, 20, sizeof(Test), true)) {
+    if(!wrm_Pool_init(&p, 20, sizeof(Test), true, NULL) || !wrm_Stack_init(&s, 20, sizeof(Test), true, NULL)) {
         wrm_fail(1, "Test", "static test start", "failed to re-initialize stack and pool");
     }
     
@@ -84,6 +250,246 @@ int main(int argv, char **argc)
     }
     printf("Pool growth test: used_count %zu, capacity %zu\n", p.used_cnt, p.cap);
 
+    // test that freed slots are reused, most recently freed first
+    wrm_Pool_freeSlot(&p, 3);
+    wrm_Pool_freeSlot(&p, 7);
+    wrm_Pool_freeSlot(&p, 7);
+    if(p.used_cnt != 19) wrm_fail(1, "Test", "pool free list", "double free changed the used count");
+    if(wrm_Pool_isValid(&p, 7)) wrm_fail(1, "Test", "pool free list", "freed slot is still valid");
+    result = wrm_Pool_getSlot(&p);
+    if(!result.exists || result.val != 7) wrm_fail(1, "Test", "pool free list", "expected to reuse slot 7");
+    result = wrm_Pool_getSlot(&p);
+    if(!result.exists || result.val != 3) wrm_fail(1, "Test", "pool free list", "expected to reuse slot 3");
+    result = wrm_Pool_getSlot(&p);
+    if(!result.exists || result.val != 21) wrm_fail(1, "Test", "pool free list", "expected a fresh slot once the free list is empty");
+    wrm_Pool_freeSlot(&p, 21);
+
+    // test that references to a freed and reused slot go stale
+    wrm_Option_Ref ref = wrm_Pool_getRef(&p, 5);
+    if(!ref.exists) wrm_fail(1, "Test", "pool refs", "failed to get a reference to a used slot");
+    if(wrm_deref(ref.val) != wrm_Pool_at(&p, 5)) wrm_fail(1, "Test", "pool refs", "reference does not resolve to its slot");
+    if(wrm_Pool_peekRef(&p, ref.val) != wrm_Pool_at(&p, 5)) wrm_fail(1, "Test", "pool refs", "read-only reference does not resolve to its slot");
+    wrm_Pool_freeSlot(&p, 5);
+    if(wrm_Pool_deref(&p, ref.val)) wrm_fail(1, "Test", "pool refs", "reference to a freed slot still resolves");
+    if(wrm_Pool_peekRef(&p, ref.val)) wrm_fail(1, "Test", "pool refs", "read-only reference to a freed slot still resolves");
+    result = wrm_Pool_getSlot(&p);
+    if(!result.exists || result.val != 5) wrm_fail(1, "Test", "pool refs", "expected to reuse slot 5");
+    if(wrm_deref(ref.val)) wrm_fail(1, "Test", "pool refs", "reference to a reused slot still resolves");
+    if(wrm_Pool_getRef(&p, 21).exists) wrm_fail(1, "Test", "pool refs", "got a reference to a free slot");
+    if(wrm_deref((wrm_Ref){ 0 })) wrm_fail(1, "Test", "pool refs", "zeroed reference resolves");
+
+    // test that a pool that fails to initialize gives back its memory and its registry entry
+    {
+        Budget budget = { .budget = 4 * sizeof(Test) }; // room for the elements, but not the bookkeeping
+        wrm_Allocator limited = { .alloc = budgetAlloc, .realloc = budgetRealloc, .free = budgetFree, .ctx = &budget };
+        wrm_Pool fp;
+        for(u32 i = 0; i <= WRM_MEMORY_MAX_POOLS; i++) {
+            if(wrm_Pool_init(&fp, 4, sizeof(Test), true, &limited)) wrm_fail(1, "Test", "pool registry", "initialized without room for the bookkeeping");
+            if(budget.used) wrm_fail(1, "Test", "pool registry", "failed init kept %zu bytes", budget.used);
+        }
+        if(!wrm_Pool_init(&fp, 4, sizeof(Test), true, NULL) || fp.id == WRM_POOL_NO_ID) {
+            wrm_fail(1, "Test", "pool registry", "failed inits used up the registry");
+        }
+        wrm_Pool_delete(&fp, NULL);
+    }
+
+    // test iterating over in-use slots
+    wrm_Pool_freeSlot(&p, 0);
+    wrm_Pool_freeSlot(&p, 10);
+    size_t visited = 0;
+    wrm_Pool_FOR_EACH(&p, i) {
+        if(!wrm_Pool_isValid(&p, i)) wrm_fail(1, "Test", "pool iteration", "visited free slot %u", i);
+        visited++;
+    }
+    if(visited != p.used_cnt) wrm_fail(1, "Test", "pool iteration", "visited %zu slots, expected %zu", visited, p.used_cnt);
+    u32 first = WRM_POOL_NO_SLOT;
+    visited = 0;
+    wrm_Pool_FOR_EACH(&p, i) {
+        first = i;
+        visited++;
+        break;
+    }
+    if(visited != 1 || first != 1) wrm_fail(1, "Test", "pool iteration", "break did not leave the loop at the first slot");
+    u64 bits[2] = { 0 };
+    wrm_bitSet(bits, 3, true);
+    wrm_bitSet(bits, 64, true);
+    wrm_bitSet(bits, 127, true);
+    if(wrm_bitNext(bits, 0, 128) != 3 || wrm_bitNext(bits, 4, 128) != 64 || wrm_bitNext(bits, 65, 128) != 127) {
+        wrm_fail(1, "Test", "bit vector", "did not find the next set bit");
+    }
+    if(wrm_bitNext(bits, 65, 100) != 100) wrm_fail(1, "Test", "bit vector", "found a set bit past the length");
+    wrm_Pool_getSlot(&p);
+    wrm_Pool_getSlot(&p);
+
+    // test that a dense pool keeps items packed and slots stable
+    wrm_Pool d;
+    if(!wrm_Pool_initDense(&d, 4, sizeof(u32), true, NULL)) wrm_fail(1, "Test", "dense pool", "failed to initialize dense pool");
+    for(u32 i = 0; i < 10; i++) {
+        result = wrm_Pool_getSlot(&d);
+        if(!result.exists) wrm_fail(1, "Test", "dense pool", "failed to get a slot");
+        *(u32*)wrm_Pool_at(&d, result.val) = result.val;
+    }
+    wrm_Pool_freeSlot(&d, 2);
+    wrm_Pool_freeSlot(&d, 0);
+    wrm_Pool_freeSlot(&d, 9);
+    for(u32 pos = 0; pos < d.used_cnt; pos++) {
+        u32 slot = d.slot_of[pos];
+        if(*(u32*)wrm_Pool_packedAt(&d, pos) != slot || wrm_Pool_at(&d, slot) != wrm_Pool_packedAt(&d, pos)) {
+            wrm_fail(1, "Test", "dense pool", "item at position %u does not match slot %u", pos, slot);
+        }
+    }
+    if(d.used_cnt != 7 || wrm_Pool_at(&d, 2)) wrm_fail(1, "Test", "dense pool", "freed slots still in the pool");
+    if(!wrm_Pool_shrink(&d, 7) || d.used_cnt != 7 || !d.packed_at) wrm_fail(1, "Test", "dense pool", "failed to shrink");
+    wrm_Pool_delete(&d, NULL);
+
+    // test that virtual pools and stacks grow in place up to their maximum capacity
+    wrm_Pool vp;
+    wrm_Stack vs;
+    if(!wrm_Pool_initVirtual(&vp, 0, 100000, sizeof(Test), NULL) || !wrm_Stack_initVirtual(&vs, 1, 100000, sizeof(Test))) {
+        wrm_fail(1, "Test", "virtual memory", "failed to initialize virtual pool and stack");
+    }
+    wrm_Pool_getSlot(&vp);
+    wrm_Stack_push(&vs);
+    void *first_item = wrm_Pool_at(&vp, 0);
+    void *first_entry = wrm_Stack_at(&vs, 0);
+    for(u32 i = 1; i < 100000; i++) {
+        if(!wrm_Pool_getSlot(&vp).exists || !wrm_Stack_push(&vs).exists) {
+            wrm_fail(1, "Test", "virtual memory", "failed to grow to %u items", i + 1);
+        }
+    }
+    if(wrm_Pool_at(&vp, 0) != first_item || wrm_Stack_at(&vs, 0) != first_entry) {
+        wrm_fail(1, "Test", "virtual memory", "items moved while growing");
+    }
+    if(wrm_Pool_getSlot(&vp).exists || wrm_Stack_push(&vs).exists) {
+        wrm_fail(1, "Test", "virtual memory", "grew past the maximum capacity");
+    }
+    wrm_Stack_reset(&vs, 10);
+    if(!wrm_Stack_shrink(&vs, 10) || !wrm_Stack_push(&vs).exists) wrm_fail(1, "Test", "virtual memory", "failed to shrink and regrow stack");
+    wrm_Pool_delete(&vp, NULL);
+    wrm_Stack_delete(&vs, NULL);
+
+    // test that a tracking allocator sees every byte a pool and stack allocate
+    wrm_Tracking_Allocator tracker;
+    wrm_Tracking_Allocator_init(&tracker, "test", NULL);
+    wrm_Pool tp;
+    wrm_Stack ts;
+    if(!wrm_Pool_initDense(&tp, 4, sizeof(Test), true, &tracker.allocator) ||
+        !wrm_Stack_init(&ts, 4, sizeof(Test), true, &tracker.allocator)
+    ) {
+        wrm_fail(1, "Test", "tracking allocator", "failed to initialize pool and stack");
+    }
+    for(u32 i = 0; i < 100; i++) {
+        wrm_Pool_getSlot(&tp);
+        wrm_Stack_push(&ts);
+    }
+    wrm_Pool_shrink(&tp, 100);
+    if(tracker.alloc_cnt == 0 || tracker.realloc_cnt == 0 || tracker.peak < tracker.bytes) {
+        wrm_fail(1, "Test", "tracking allocator", "did not count allocations");
+    }
+    wrm_Pool_delete(&tp, NULL);
+    wrm_Stack_delete(&ts, NULL);
+    wrm_Tracking_Allocator_print(&tracker);
+    if(tracker.bytes != 0 || tracker.free_cnt != tracker.alloc_cnt) {
+        wrm_fail(1, "Test", "tracking allocator", "%zu bytes still allocated after deleting everything", tracker.bytes);
+    }
+
+    // test that a slab allocator sorts objects into size classes and reuses freed blocks
+    wrm_Slab_Allocator slab;
+    wrm_Slab_Allocator_init(&slab, NULL);
+    if(wrm_Slab_class(1) != 0 || wrm_Slab_class(16) != 0 || wrm_Slab_class(17) != 1 || wrm_Slab_class(4096) != WRM_SLAB_CLASS_CNT - 1) {
+        wrm_fail(1, "Test", "slab allocator", "wrong size classes");
+    }
+    u8 *small = wrm_alloc(&slab.allocator, 24);
+    u8 *other = wrm_alloc(&slab.allocator, 30);
+    if(!small || other != small + 32) wrm_fail(1, "Test", "slab allocator", "blocks of a class are not adjacent");
+    memset(small, 0xff, 24);
+    wrm_free(&slab.allocator, small, 24);
+    u8 *reused = wrm_alloc(&slab.allocator, 20);
+    if(reused != small || reused[0] || reused[19]) wrm_fail(1, "Test", "slab allocator", "freed block was not reused and cleared");
+    reused[0] = 42;
+    u8 *moved = wrm_realloc(&slab.allocator, reused, 20, 100);
+    if(!moved || moved[0] != 42) wrm_fail(1, "Test", "slab allocator", "realloc lost the contents");
+    u8 *large = wrm_alloc(&slab.allocator, 10000);
+    if(!large) wrm_fail(1, "Test", "slab allocator", "failed to allocate a large object");
+    wrm_free(&slab.allocator, large, 10000);
+    for(u32 i = 0; i < 1000; i++) {
+        if(!wrm_alloc(&slab.allocator, 4000)) wrm_fail(1, "Test", "slab allocator", "failed to allocate a new slab");
+    }
+    wrm_Slab_Allocator_delete(&slab);
+    if(slab.slab_cnt || slab.slabs) wrm_fail(1, "Test", "slab allocator", "slabs not released");
+
+    // stress test a concurrent pool: no slot is handed out twice, and every slot comes back
+    if(!wrm_Concurrent_Pool_init(&stress_pool, STRESS_CAP, sizeof(Stress_Item), NULL)) {
+        wrm_fail(1, "Test", "concurrent pool", "failed to initialize concurrent pool");
+    }
+    pthread_t threads[STRESS_THREADS];
+    for(u32 i = 0; i < STRESS_THREADS; i++) {
+        pthread_create(&threads[i], NULL, stressThread, (void*)(uintptr_t)(i + 1));
+    }
+    for(u32 i = 0; i < STRESS_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    if(stress_pool.used_cnt != 0) wrm_fail(1, "Test", "concurrent pool", "%zu slots still in use", (size_t)stress_pool.used_cnt);
+    u64 seen[wrm_BIT_WORDS(STRESS_CAP)] = { 0 };
+    for(u32 i = 0; i < STRESS_CAP; i++) {
+        wrm_Option_Ref result = wrm_Concurrent_Pool_getSlot(&stress_pool);
+        if(!result.exists || wrm_bitAt(seen, result.val.idx)) wrm_fail(1, "Test", "concurrent pool", "free list lost or repeated a slot");
+        wrm_bitSet(seen, result.val.idx, true);
+    }
+    if(wrm_Concurrent_Pool_getSlot(&stress_pool).exists) wrm_fail(1, "Test", "concurrent pool", "got a slot past capacity");
+    wrm_Concurrent_Pool_delete(&stress_pool);
+
+    // test a ring: wrapping spans, a full ring, and hand-off between threads
+    {
+        wrm_Ring r;
+        if(!wrm_Ring_init(&r, 8, sizeof(u32), false, NULL)) wrm_fail(1, "Test", "ring", "failed to initialize ring");
+        u32 in[10] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+        u32 out[10];
+        if(wrm_Ring_push(&r, in, 6) != 6 || wrm_Ring_pop(&r, out, 4) != 4 || out[3] != 3) wrm_fail(1, "Test", "ring", "batch push and pop failed");
+        // 2 left; 6 more fit, wrapping around the end of the array
+        if(wrm_Ring_push(&r, in, 10) != 6 || wrm_Ring_len(&r) != 8) wrm_fail(1, "Test", "ring", "pushed past capacity");
+        if(wrm_Ring_reserve(&r, 1).cnt) wrm_fail(1, "Test", "ring", "reserved in a full ring");
+        wrm_Ring_Span span = wrm_Ring_peek(&r, 8);
+        if(span.cnt != 4 || ((u32*)span.data)[0] != 4) wrm_fail(1, "Test", "ring", "peek did not stop at the end of the array");
+        wrm_Ring_release(&r, span);
+        if(wrm_Ring_pop(&r, out, 10) != 4 || out[0] != 2 || out[3] != 5 || wrm_Ring_len(&r)) wrm_fail(1, "Test", "ring", "wrapped pop failed");
+        wrm_Ring_delete(&r);
+    }
+    ringStress(1);
+    ringStress(RING_PRODUCERS);
+
+    // test arena alignment, markers and growth
+    wrm_Arena a;
+    if(!wrm_Arena_init(&a, 64, 1 << 20)) wrm_fail(1, "Test", "arena", "failed to initialize arena");
+    u8 *byte = wrm_Arena_push(&a, 1, 1);
+    double *dbl = wrm_Arena_PUSH(&a, double, 1);
+    if(!byte || !dbl || (uintptr_t)dbl % _Alignof(double)) wrm_fail(1, "Test", "arena", "push was not aligned");
+    wrm_Arena_Marker mark = wrm_Arena_mark(&a);
+    u8 *big = wrm_Arena_push(&a, 100000, 16);
+    if(!big || a.commit_cnt == 0) wrm_fail(1, "Test", "arena", "failed to grow");
+    memset(big, 1, 100000);
+    wrm_Arena_restore(&a, mark);
+    if(wrm_Arena_PUSH(&a, u8, 100000) != big) wrm_fail(1, "Test", "arena", "restore did not roll back to the marker");
+    if(wrm_Arena_push(&a, 1 << 20, 1)) wrm_fail(1, "Test", "arena", "pushed past the maximum capacity");
+    wrm_Arena_delete(&a);
+
+    // test that a frame arena keeps last frame's data and stops committing in a steady state
+    wrm_Frame_Arena fa;
+    if(!wrm_Frame_Arena_init(&fa, 0, 1 << 20)) wrm_fail(1, "Test", "frame arena", "failed to initialize frame arena");
+    u32 *last = NULL;
+    size_t commits = 0;
+    for(u32 frame = 0; frame < 10; frame++) {
+        if(frame == 2) { commits = fa.arenas[0].commit_cnt + fa.arenas[1].commit_cnt; }
+        u32 *curr = wrm_Arena_PUSH(wrm_Frame_Arena_get(&fa), u32, 1000);
+        if(!curr) wrm_fail(1, "Test", "frame arena", "failed to push on frame %u", frame);
+        curr[999] = frame;
+        if(last && last[999] != frame - 1) wrm_fail(1, "Test", "frame arena", "last frame's data was overwritten");
+        last = curr;
+        wrm_Frame_Arena_swap(&fa);
+    }
+    if(fa.arenas[0].commit_cnt + fa.arenas[1].commit_cnt != commits) wrm_fail(1, "Test", "frame arena", "committed memory in a steady state");
+    wrm_Frame_Arena_delete(&fa);
+
     // test pushing to growable stack
     for(int i = 0; i < 21; i++) {
         result = wrm_Stack_push(&s);
@@ -94,7 +500,7 @@ int main(int argv, char **argc)
 
 
     wrm_Tree t;
-    if(!wrm_Tree_init(&t, &p, offsetof(Test, node), 8, true)) {
+    if(!wrm_Tree_init(&t, &p, offsetof(Test, node))) {
         wrm_fail(1, "Test", "tree start", "failed to initialize tree");
     }
 
@@ -107,23 +513,21 @@ int main(int argv, char **argc)
         printChildren(i, test, &t);
     }
 
-    for(u8 i = 0; i < t.child_limit; i++) {
-        if(!wrm_Tree_addChild(&t, 0, i + 1)) {
-            wrm_fail(1, "Test", "add children", "could not add child %u to %u", i + 1, 0);
+    // no fan-out limit: every other live element can be a child of element 0
+    for(u32 i = 1; i < p.cap; i++) {
+        if(wrm_Pool_isValid(&p, i) && !wrm_Tree_addChild(&t, 0, i)) {
+            wrm_fail(1, "Test", "add children", "could not add child %u to %u", i, 0);
         }
     }
-    if(wrm_Tree_addChild(&t, 0, t.child_limit + 1)) {
-        wrm_fail(1, "Test", "add children", "should not be able to add another child to %u", 0);
-    }
     printf("After adding:\n");
     for(int i = 0; i < p.cap; i++) {
         Test *test = wrm_Pool_at(&p, i);
         printChildren(i, test, &t);
     }
 
-    for(u8 i = 0; i < t.child_limit; i++) {
-        if(!wrm_Tree_removeChild(&t, 0, i + 1)) {
-            wrm_fail(1, "Test", "remove children", "could not remove child %u from %u", i + 1, 0);
+    for(u32 i = 1; i < p.cap; i++) {
+        if(wrm_Pool_isValid(&p, i) && !wrm_Tree_removeChild(&t, 0, i)) {
+            wrm_fail(1, "Test", "remove children", "could not remove child %u from %u", i, 0);
         }
     }
     printf("After removing:\n");
@@ -131,7 +535,7 @@ int main(int argv, char **argc)
         Test *test = wrm_Pool_at(&p, i);
         printChildren(i, test, &t);
     }
-    if(wrm_Tree_removeChild(&t, 0, t.child_limit + 1)) {
+    if(wrm_Tree_removeChild(&t, 0, 1)) {
         wrm_fail(1, "Test", "remove children", "should not be able to remove another child from %u", 0);
     }
 
@@ -142,6 +546,523 @@ int main(int argv, char **argc)
 
     if(wrm_Tree_addChild(&t, 0, 100)) wrm_fail(1, "Test", "add invalid", "should not be able to add an invalid child");
     if(wrm_Tree_addChild(&t, 100, 0)) wrm_fail(1, "Test", "add invalid", "should not be able to add an invalid parent");
+    if(wrm_Tree_addChild(&t, 2, 2)) wrm_fail(1, "Test", "add invalid", "should not be able to make a node its own child");
+    wrm_Tree_delete(&t);
+
+    // test a wide tree: removing from the front, middle and back keeps the order of the rest
+    {
+        wrm_Pool wp;
+        wrm_Tree wt;
+        const u32 wide = 600;
+        if(!wrm_Pool_init(&wp, wide, sizeof(Test), false, NULL) || !wrm_Tree_init(&wt, &wp, offsetof(Test, node))) {
+            wrm_fail(1, "Test", "wide tree", "failed to initialize pool and tree");
+        }
+        for(u32 i = 0; i < wide; i++) { wrm_Pool_getSlot(&wp); }
+        for(u32 i = 1; i < wide; i++) {
+            if(!wrm_Tree_addChild(&wt, 0, i)) wrm_fail(1, "Test", "wide tree", "could not add child %u", i);
+        }
+        for(u32 i = 1; i < wide; i += 3) {
+            if(!wrm_Tree_removeChild(&wt, 0, i)) wrm_fail(1, "Test", "wide tree", "could not remove child %u", i);
+        }
+        if(!wrm_Tree_removeChild(&wt, 0, wide - 1)) wrm_fail(1, "Test", "wide tree", "could not remove the last child");
+
+        Test *root = wrm_Pool_at(&wp, 0);
+        u32 expected = 2, seen = 0, last = 0;
+        wrm_Tree_FOR_EACH_CHILD(&wt, &root->node, c) {
+            if(expected % 3 == 1) { expected++; }
+            if(c != expected) wrm_fail(1, "Test", "wide tree", "child %u out of order, expected %u", c, expected);
+            expected++;
+            seen++;
+            last = c;
+        }
+        if(seen != root->node.child_cnt || seen != wide - 202 || last != root->node.last_child) wrm_fail(1, "Test", "wide tree", "walked %u of %u children", seen, root->node.child_cnt);
+        if(wrm_Tree_hasChild(&wt, 0, 1) || !wrm_Tree_hasChild(&wt, 0, 2)) wrm_fail(1, "Test", "wide tree", "wrong membership after removal");
+
+        // re-adding goes to the back
+        if(!wrm_Tree_addChild(&wt, 0, 1) || root->node.last_child != 1) wrm_fail(1, "Test", "wide tree", "re-added child is not last");
+        wrm_Tree_delete(&wt);
+        wrm_Pool_delete(&wp, NULL);
+    }
+
+    // test flattening: pre-order layout, subtree sizes, forward parent loops and lazy rebuilds
+    {
+        wrm_Pool fp;
+        wrm_Tree ft;
+        if(!wrm_Pool_init(&fp, 10, sizeof(Test), false, NULL) || !wrm_Tree_initFlat(&ft, &fp, offsetof(Test, node), NULL)) {
+            wrm_fail(1, "Test", "flat tree", "failed to initialize pool and tree");
+        }
+        for(u32 i = 0; i < 10; i++) { wrm_Pool_getSlot(&fp); }
+        u32 links[][2] = { {0, 3}, {0, 1}, {3, 5}, {3, 6}, {6, 9}, {2, 4} };
+        for(u32 i = 0; i < sizeof(links) / sizeof(links[0]); i++) {
+            if(!wrm_Tree_addChild(&ft, links[i][0], links[i][1])) wrm_fail(1, "Test", "flat tree", "could not add child %u", links[i][1]);
+        }
+#ifdef WRM_TREE_CHECK_CYCLES
+        if(wrm_Tree_addChild(&ft, 9, 0)) wrm_fail(1, "Test", "flat tree", "should not be able to make an ancestor a child");
+#endif
+
+        u32 order[] = { 0, 3, 5, 6, 9, 1, 2, 4, 7, 8 };
+        u32 sizes[] = { 6, 4, 1, 2, 1, 1, 2, 1, 1, 1 };
+        if(!wrm_Tree_flatten(&ft) || ft.flat_len != 10) wrm_fail(1, "Test", "flat tree", "failed to flatten");
+        u32 depth[10];
+        for(u32 pos = 0; pos < ft.flat_len; pos++) {
+            if(ft.order[pos] != order[pos] || ft.subtree_len[pos] != sizes[pos]) {
+                wrm_fail(1, "Test", "flat tree", "position %u holds node %u with %u nodes", pos, ft.order[pos], ft.subtree_len[pos]);
+            }
+            // parents come first, so per-node values can be accumulated in one forward loop
+            u32 parent = ft.parent_pos[pos];
+            depth[pos] = parent == WRM_POOL_NO_SLOT ? 0 : depth[parent] + 1;
+
+            u32 expected = 0;
+            for(wrm_Tree_Node *n = wrm_Tree_at(&ft, ft.order[pos]); n->has_parent; n = wrm_Tree_at(&ft, n->parent)) { expected++; }
+            if(depth[pos] != expected) wrm_fail(1, "Test", "flat tree", "node %u has depth %u, expected %u", ft.order[pos], depth[pos], expected);
+        }
+
+        // nothing changed, so this must not rebuild
+        ft.order[0] = 1000;
+        if(!wrm_Tree_flatten(&ft) || ft.order[0] != 1000) wrm_fail(1, "Test", "flat tree", "rebuilt without a topology change");
+        ft.order[0] = 0;
+
+        // iterators and visitors keep their path in an arena and can prune subtrees
+        wrm_Arena ia;
+        if(!wrm_Arena_init(&ia, 4096, 1 << 20)) wrm_fail(1, "Test", "tree iteration", "failed to initialize arena");
+        wrm_Tree_Iter it;
+        u32 pre[] = { 0, 3, 5, 6, 9, 1 };
+        u32 post[] = { 5, 9, 6, 3, 1, 0 };
+        u32 pruned[] = { 0, 3, 1 };
+        for(int mode = 0; mode < 3; mode++) {
+            u32 *expected = mode == 0 ? pre : mode == 1 ? post : pruned;
+            u32 len = mode == 2 ? 3 : 6;
+            u32 cnt = 0;
+            wrm_Tree_Iter_init(&it, &ft, 0, mode == 1, &ia);
+            for(wrm_Option_Handle n = wrm_Tree_Iter_next(&it); n.exists; n = wrm_Tree_Iter_next(&it)) {
+                if(cnt == len || n.val != expected[cnt]) wrm_fail(1, "Test", "tree iteration", "mode %d visited %u at step %u", mode, n.val, cnt);
+                if(mode == 2 && n.val == 3) { wrm_Tree_Iter_skipChildren(&it); }
+                cnt++;
+            }
+            if(cnt != len || it.overflow || wrm_Tree_Iter_next(&it).exists) wrm_fail(1, "Test", "tree iteration", "mode %d stopped after %u nodes", mode, cnt);
+        }
+
+        Visit_Log log = { .prune = 6 };
+        u32 entered[] = { 0, 3, 5, 6, 1 };
+        u32 left[] = { 5, 6, 3, 1, 0 };
+        u32 depths[] = { 0, 1, 2, 2, 1 };
+        if(!wrm_Tree_visit(&ft, 0, &ia, visitEnter, visitLeave, &log) || log.enter_cnt != 5 || log.leave_cnt != 5) {
+            wrm_fail(1, "Test", "tree visit", "visited %u nodes, left %u", log.enter_cnt, log.leave_cnt);
+        }
+        for(u32 i = 0; i < 5; i++) {
+            if(log.entered[i] != entered[i] || log.left[i] != left[i] || log.depths[i] != depths[i]) wrm_fail(1, "Test", "tree visit", "wrong order at step %u", i);
+        }
+        wrm_Arena_reset(&ia);
+
+        u32 moved[] = { 0, 3, 5, 1, 2, 4, 6, 9, 7, 8 };
+        wrm_Tree_removeChild(&ft, 3, 6);
+        if(!ft.stale || !wrm_Tree_flatten(&ft)) wrm_fail(1, "Test", "flat tree", "failed to rebuild after removing a child");
+        for(u32 pos = 0; pos < ft.flat_len; pos++) {
+            if(ft.order[pos] != moved[pos]) wrm_fail(1, "Test", "flat tree", "position %u holds node %u after removal", pos, ft.order[pos]);
+        }
+
+        u32 detached[] = { 1, 2, 4, 3, 5, 6, 9, 7, 8 };
+        if(!wrm_Tree_detach(&ft, 0)) wrm_fail(1, "Test", "flat tree", "could not detach a node");
+        wrm_Pool_freeSlot(&fp, 0);
+        if(!wrm_Tree_flatten(&ft) || ft.flat_len != 9) wrm_fail(1, "Test", "flat tree", "failed to rebuild after detaching");
+        for(u32 pos = 0; pos < ft.flat_len; pos++) {
+            if(ft.order[pos] != detached[pos]) wrm_fail(1, "Test", "flat tree", "position %u holds node %u after detaching", pos, ft.order[pos]);
+        }
+        wrm_Arena_delete(&ia);
+        wrm_Tree_delete(&ft);
+        wrm_Pool_delete(&fp, NULL);
+    }
+
+    // a deep chain is walked without recursion, until the arena is full
+    {
+        wrm_Pool dp;
+        wrm_Tree dt;
+        wrm_Arena da;
+        const u32 deep = 100000;
+        if(!wrm_Pool_init(&dp, deep, sizeof(Test), false, NULL) || !wrm_Tree_init(&dt, &dp, offsetof(Test, node)) || !wrm_Arena_init(&da, 4096, 1 << 20)) {
+            wrm_fail(1, "Test", "deep tree", "failed to initialize pool, tree and arena");
+        }
+        for(u32 i = 0; i < deep; i++) {
+            wrm_Pool_getSlot(&dp);
+            if(i && !wrm_Tree_addChild(&dt, i - 1, i)) wrm_fail(1, "Test", "deep tree", "could not add child %u", i);
+        }
+        wrm_Tree_Iter it;
+        wrm_Tree_Iter_init(&it, &dt, 0, true, &da);
+        u32 expected = deep;
+        for(wrm_Option_Handle n = wrm_Tree_Iter_next(&it); n.exists; n = wrm_Tree_Iter_next(&it)) {
+            if(n.val != --expected) wrm_fail(1, "Test", "deep tree", "visited %u, expected %u", n.val, expected);
+        }
+        if(expected != 0 || it.overflow) wrm_fail(1, "Test", "deep tree", "post-order walk stopped at %u", expected);
+
+        wrm_Arena small;
+        wrm_Arena_init(&small, 4096, 4096);
+        wrm_Tree_Iter_init(&it, &dt, 0, false, &small);
+        while(wrm_Tree_Iter_next(&it).exists) {}
+        if(!it.overflow) wrm_fail(1, "Test", "deep tree", "a full arena was not reported");
+
+        wrm_Arena_delete(&small);
+        wrm_Arena_delete(&da);
+        wrm_Tree_delete(&dt);
+        wrm_Pool_delete(&dp, NULL);
+    }
+
+    // test that compaction keeps index fields and tree links pointing at the same items
+    for(int dense = 0; dense < 2; dense++) {
+        wrm_Pool cp;
+        wrm_Tree ct;
+        bool ok = dense ? wrm_Pool_initDense(&cp, 8, sizeof(Linked), true, NULL) : wrm_Pool_init(&cp, 8, sizeof(Linked), true, NULL);
+        if(!ok || !wrm_Tree_initFlat(&ct, &cp, offsetof(Linked, node), NULL) || !wrm_Pool_addIndexField(&cp, &cp, offsetof(Linked, buddy))) {
+            wrm_fail(1, "Test", "compaction", "failed to initialize pool and tree");
+        }
+        for(u32 i = 0; i < 40; i++) {
+            Linked *l = wrm_Pool_at(&cp, wrm_Pool_getSlot(&cp).val);
+            l->value = i;
+            l->buddy = 39 - i;
+        }
+        for(u32 i = 31; i < 35; i++) { wrm_Tree_addChild(&ct, 30, i); }
+        for(u32 i = 1; i < 40; i += 3) {
+            if((i < 30 || i > 34) && (39 - i < 30 || 39 - i > 34)) { // keep the tree
+                wrm_Pool_freeSlot(&cp, i);
+                wrm_Pool_freeSlot(&cp, 39 - i); // keep buddies paired
+            }
+        }
+        wrm_Option_Ref kept = wrm_Pool_getRef(&cp, 0);
+        wrm_Option_Ref moved = wrm_Pool_getRef(&cp, 39);
+        u32 remap[40];
+        u32 flat[40];
+        size_t used = cp.used_cnt;
+        if(!wrm_Tree_flatten(&ct) || ct.flat_len != used) wrm_fail(1, "Test", "compaction", "failed to flatten");
+        memcpy(flat, ct.order, used * sizeof(u32));
+        if(!wrm_Pool_compact(&cp, remap) || cp.top != used) wrm_fail(1, "Test", "compaction", "failed to compact");
+        for(u32 pos = 0; pos < used; pos++) {
+            if(ct.stale || ct.order[pos] != remap[flat[pos]]) wrm_fail(1, "Test", "compaction", "flattened order not remapped");
+        }
+        wrm_Pool_FOR_EACH(&cp, i) {
+            Linked *l = wrm_Pool_at(&cp, i);
+            Linked *buddy = wrm_Pool_at(&cp, l->buddy);
+            if(!buddy || buddy->value != 39 - l->value) wrm_fail(1, "Test", "compaction", "index field of item %u not remapped", l->value);
+        }
+        Linked *parent = wrm_Pool_at(&cp, remap[30]);
+        if(!parent || parent->value != 30 || parent->node.child_cnt != 4) wrm_fail(1, "Test", "compaction", "lost the tree parent");
+        for(u32 i = 31; i < 35; i++) {
+            Linked *child = wrm_Pool_at(&cp, remap[i]);
+            if(!wrm_Tree_hasChild(&ct, remap[30], remap[i]) || child->node.parent != remap[30] || child->value != i) {
+                wrm_fail(1, "Test", "compaction", "lost the tree link to child %u", i);
+            }
+        }
+        u32 expected = 31;
+        wrm_Tree_FOR_EACH_CHILD(&ct, &parent->node, c) {
+            if(c != remap[expected++]) wrm_fail(1, "Test", "compaction", "sibling links out of order");
+        }
+        if(!kept.exists || !wrm_Pool_deref(&cp, kept.val)) wrm_fail(1, "Test", "compaction", "reference to an item that stayed put went stale");
+        if(remap[39] == 39 || wrm_Pool_deref(&cp, moved.val)) wrm_fail(1, "Test", "compaction", "reference to a moved item still resolves");
+        if(!wrm_Pool_shrink(&cp, used) || cp.cap != used || !wrm_Pool_isValid(&cp, used - 1)) wrm_fail(1, "Test", "compaction", "failed to shrink");
+        wrm_Pool_getSlot(&cp);
+        wrm_Tree_delete(&ct);
+        wrm_Pool_delete(&cp, NULL);
+    }
+
+    // test a map: growth, overwrites, removal with probe chains intact, and iteration
+    {
+        wrm_Map m;
+        const u32 keys = 20000;
+        if(!wrm_Map_init(&m, 0, sizeof(u32), sizeof(u64), NULL, NULL, NULL)) wrm_fail(1, "Test", "map", "failed to initialize map");
+        for(u32 k = 0; k < keys; k++) {
+            u64 v = (u64)k * 3;
+            if(!wrm_Map_put(&m, &k, &v)) wrm_fail(1, "Test", "map", "failed to put key %u", k);
+        }
+        for(u32 k = 0; k < keys; k += 2) {
+            if(!wrm_Map_remove(&m, &k)) wrm_fail(1, "Test", "map", "failed to remove key %u", k);
+        }
+        u32 missing = keys;
+        if(m.len != keys / 2 || wrm_Map_get(&m, &missing) || wrm_Map_remove(&m, &missing)) wrm_fail(1, "Test", "map", "found a key that was never put");
+        for(u32 k = 0; k < keys; k++) {
+            u64 *v = wrm_Map_get(&m, &k);
+            if((k % 2 == 0) != (v == NULL) || (v && *v != (u64)k * 3)) wrm_fail(1, "Test", "map", "wrong lookup for key %u", k);
+        }
+
+        // removed slots are reused without growing, and overwrites keep the count
+        size_t cap = m.cap;
+        for(u32 k = 0; k < keys; k += 2) {
+            if(!wrm_Map_put(&m, &k, NULL)) wrm_fail(1, "Test", "map", "failed to put key %u again", k);
+        }
+        u64 seven = 7;
+        wrm_Map_put(&m, &missing, &seven);
+        wrm_Map_put(&m, &missing, &seven);
+        if(m.len != keys + 1 || m.cap != cap || *(u64*)wrm_Map_get(&m, &missing) != 7) wrm_fail(1, "Test", "map", "wrong count after overwriting");
+
+        u64 sum = 0;
+        size_t seen = 0;
+        wrm_Map_FOR_EACH(&m, i) {
+            sum += *(u64*)wrm_Map_valueAt(&m, i);
+            seen++;
+        }
+        if(seen != m.len || sum != 7 + 3ull * ((keys / 2) * (keys / 2)) ) wrm_fail(1, "Test", "map", "iteration saw %zu entries", seen);
+
+        wrm_Map_clear(&m);
+        if(m.len || wrm_Map_get(&m, &missing)) wrm_fail(1, "Test", "map", "entries survived a clear");
+        wrm_Map_delete(&m);
+
+        // string keys, in an arena: growing the most recent allocation happens in place
+        wrm_Arena ma;
+        if(!wrm_Arena_init(&ma, 4096, 1 << 20) || !wrm_Map_init(&m, 4, sizeof(const char*), sizeof(u32), wrm_Map_hashStr, wrm_Map_equalsStr, &ma.allocator)) {
+            wrm_fail(1, "Test", "map", "failed to initialize string map");
+        }
+        const char *names[] = { "default", "colored", "textured", "text", "image", "pane" };
+        for(u32 i = 0; i < 6; i++) { wrm_Map_put(&m, &names[i], &i); }
+        char lookup[16];
+        strcpy(lookup, "text");
+        const char *key = lookup;
+        u32 *found = wrm_Map_get(&m, &key);
+        if(!found || *found != 3 || m.len != 6) wrm_fail(1, "Test", "map", "string lookup failed");
+        wrm_Map_delete(&m);
+        if(ma.pos != 0) wrm_fail(1, "Test", "arena allocator", "freeing the last allocation did not roll the arena back");
+
+        u8 *grown = wrm_alloc(&ma.allocator, 100);
+        if(wrm_realloc(&ma.allocator, grown, 100, 5000) != grown || ma.pos != 5000) wrm_fail(1, "Test", "arena allocator", "the last allocation did not grow in place");
+        wrm_Arena_delete(&ma);
+    }
+
+    // test a structure-of-arrays pool: growth, zeroing of every field, and compaction moving all fields together
+    {
+        wrm_Soa_Pool sp;
+        const size_t sizes[] = { sizeof(u32), sizeof(float) * 3, sizeof(u8) };
+        if(!wrm_Soa_Pool_init(&sp, 2, sizes, 3, true, NULL)) wrm_fail(1, "Test", "SoA pool", "failed to initialize pool");
+        for(u32 i = 0; i < 100; i++) {
+            wrm_Option_Handle h = wrm_Soa_Pool_getSlot(&sp);
+            if(!h.exists || h.val != i) wrm_fail(1, "Test", "SoA pool", "failed to get slot %u", i);
+            wrm_Soa_Pool_ARRAY(&sp, 0, u32)[i] = i;
+            wrm_Soa_Pool_ARRAY(&sp, 1, float)[i * 3 + 2] = (float)i;
+            *(u8*)wrm_Soa_Pool_at(&sp, 2, i) = (u8)(i + 1);
+        }
+        if(sp.slots.cap < 100 || wrm_Soa_Pool_at(&sp, 3, 0) || wrm_Soa_Pool_at(&sp, 0, 100)) wrm_fail(1, "Test", "SoA pool", "bad bounds after growth");
+
+        for(u32 i = 0; i < 100; i += 3) { wrm_Soa_Pool_freeSlot(&sp, i); }
+        wrm_Option_Handle reused = wrm_Soa_Pool_getSlot(&sp);
+        if(!reused.exists || *(u8*)wrm_Soa_Pool_at(&sp, 2, reused.val) || wrm_Soa_Pool_ARRAY(&sp, 1, float)[reused.val * 3 + 2] != 0.0f) {
+            wrm_fail(1, "Test", "SoA pool", "reused slot was not zeroed");
+        }
+        wrm_Soa_Pool_freeSlot(&sp, reused.val);
+
+        if(!wrm_Soa_Pool_compact(&sp, NULL) || sp.slots.top != sp.slots.used_cnt) wrm_fail(1, "Test", "SoA pool", "failed to compact");
+        u32 *ids = wrm_Soa_Pool_ARRAY(&sp, 0, u32);
+        float *pos = wrm_Soa_Pool_ARRAY(&sp, 1, float);
+        u8 *tags = wrm_Soa_Pool_ARRAY(&sp, 2, u8);
+        for(u32 i = 0; i < sp.slots.used_cnt; i++) {
+            if(ids[i] % 3 == 0 || pos[i * 3 + 2] != (float)ids[i] || tags[i] != (u8)(ids[i] + 1)) wrm_fail(1, "Test", "SoA pool", "fields split up by compaction at %u", i);
+        }
+        wrm_Soa_Pool_delete(&sp);
+
+        // hooks on the slot pool see every field already moved
+        const size_t pair[] = { sizeof(u32), sizeof(u32) };
+        if(!wrm_Soa_Pool_init(&sp, 16, pair, 2, false, NULL)) wrm_fail(1, "Test", "SoA pool", "failed to initialize pool");
+        for(u32 i = 0; i < 16; i++) {
+            wrm_Soa_Pool_getSlot(&sp);
+            wrm_Soa_Pool_ARRAY(&sp, 0, u32)[i] = i;
+            wrm_Soa_Pool_ARRAY(&sp, 1, u32)[i] = i;
+        }
+        for(u32 i = 0; i < 16; i += 2) { wrm_Soa_Pool_freeSlot(&sp, i); }
+        wrm_Pool_addRemapHook(&sp.slots, soaCheckHook, &sp);
+        if(!wrm_Soa_Pool_compact(&sp, NULL)) wrm_fail(1, "Test", "SoA pool", "failed to compact");
+        wrm_Soa_Pool_delete(&sp);
+
+        // a failed growth leaves every field at the old capacity, so all of it is given back
+        Budget budget = { .budget = 1130 };
+        wrm_Allocator limited = { .alloc = budgetAlloc, .realloc = budgetRealloc, .free = budgetFree, .ctx = &budget };
+        const size_t wide[] = { sizeof(u32), 64 };
+        if(!wrm_Soa_Pool_init(&sp, 8, wide, 2, true, &limited)) wrm_fail(1, "Test", "SoA pool", "failed to initialize pool");
+        bool ran_out = false;
+        for(u32 i = 0; i < 1000 && !ran_out; i++) { ran_out = !wrm_Soa_Pool_getSlot(&sp).exists; }
+        if(!ran_out) wrm_fail(1, "Test", "SoA pool", "grew past its allocator's budget");
+        wrm_Soa_Pool_delete(&sp);
+        if(budget.used) wrm_fail(1, "Test", "SoA pool", "%zu bytes unaccounted for after a failed growth", budget.used);
+
+        // the same for a plain pool, whose bookkeeping arrays must also keep their old size
+        budget = (Budget){ .budget = 1130 };
+        wrm_Pool bp;
+        if(!wrm_Pool_init(&bp, 8, 64, true, &limited)) wrm_fail(1, "Test", "pool", "failed to initialize pool");
+        ran_out = false;
+        for(u32 i = 0; i < 1000 && !ran_out; i++) { ran_out = !wrm_Pool_getSlot(&bp).exists; }
+        if(!ran_out) wrm_fail(1, "Test", "pool", "grew past its allocator's budget");
+        if(wrm_Pool_isValid(&bp, (u32)bp.cap) || !wrm_Pool_isValid(&bp, (u32)bp.cap - 1)) wrm_fail(1, "Test", "pool", "capacity changed in a failed growth");
+        wrm_Pool_delete(&bp, NULL);
+        if(budget.used) wrm_fail(1, "Test", "pool", "%zu bytes unaccounted for after a failed growth", budget.used);
+    }
+
+    // test statistics: counters through growth, the registry, leak reports, and untracking on delete
+    {
+        wrm_Pool sp;
+        wrm_Stack ss;
+        if(!wrm_Pool_init(&sp, 4, sizeof(u64), true, NULL) || !wrm_Stack_init(&ss, 4, sizeof(u32), true, NULL)) {
+            wrm_fail(1, "Test", "stats", "failed to initialize containers");
+        }
+        if(!wrm_memoryTrack("stats pool", WRM_MEMORY_POOL, &sp) || !wrm_memoryTrack("stats stack", WRM_MEMORY_STACK, &ss)) {
+            wrm_fail(1, "Test", "stats", "failed to track containers");
+        }
+        wrm_Pool_getSlot(&sp);
+        wrm_memoryExpect(&sp);
+        for(u32 i = 0; i < 9; i++) { wrm_Pool_getSlot(&sp); wrm_Stack_push(&ss); }
+        for(u32 i = 1; i < 10; i += 2) { wrm_Pool_freeSlot(&sp, i); }
+        wrm_Stack_reset(&ss, 2);
+
+        wrm_Memory_Stats ps = wrm_memoryStats(WRM_MEMORY_POOL, &sp);
+        if(!ps.name || strcmp(ps.name, "stats pool") || ps.cap != 16 || ps.len != 5 || ps.peak != 10 || ps.realloc_cnt != 2) {
+            wrm_fail(1, "Test", "stats", "wrong pool stats: cap %zu, live %zu, peak %zu, resizes %zu", ps.cap, ps.len, ps.peak, ps.realloc_cnt);
+        }
+        // 4 then 8 slots of data, generations, free slots, plus one word of occupancy each time
+        size_t moved = (4 + 8) * (sizeof(u64) + 2 * sizeof(u32)) + 2 * sizeof(u64);
+        if(ps.realloc_bytes != moved) wrm_fail(1, "Test", "stats", "pool moved %zu bytes, expected %zu", ps.realloc_bytes, moved);
+
+        wrm_Memory_Stats st = wrm_memoryStats(WRM_MEMORY_STACK, &ss);
+        if(st.len != 2 || st.peak != 9 || st.cap != 16 || st.realloc_cnt != 2 || st.realloc_bytes != (4 + 8) * sizeof(u32)) {
+            wrm_fail(1, "Test", "stats", "wrong stack stats");
+        }
+        if(wrm_memoryReportLeaks(&sp) != 4) wrm_fail(1, "Test", "stats", "wrong leak count");
+
+        FILE *f = tmpfile();
+        wrm_memoryDump(f, true);
+        rewind(f);
+        char json[1024] = { 0 };
+        fread(json, 1, sizeof(json) - 1, f);
+        fclose(f);
+        if(!strstr(json, "\"name\": \"stats pool\", \"kind\": \"pool\", \"element_size\": 8, \"capacity\": 16, \"live\": 5, \"peak\": 10")) {
+            wrm_fail(1, "Test", "stats", "missing pool in JSON dump: %s", json);
+        }
+
+        wrm_Pool_delete(&sp, NULL);
+        wrm_Stack_delete(&ss, NULL);
+        if(wrm_memoryStats(WRM_MEMORY_POOL, &sp).name || wrm_memoryReportLeaks(&ss)) wrm_fail(1, "Test", "stats", "deleted containers are still tracked");
+    }
+
+    // test snapshots of a dense pool with a flattened tree, and a stack: delta and full restores
+    {
+        const u32 items = 300;
+        wrm_Pool sp;
+        wrm_Tree st;
+        wrm_Stack ss;
+        if(!wrm_Pool_initDense(&sp, 64, sizeof(Linked), true, NULL) || !wrm_Tree_initFlat(&st, &sp, offsetof(Linked, node), NULL) ||
+            !wrm_Stack_init(&ss, 4, sizeof(u32), true, NULL)
+        ) {
+            wrm_fail(1, "Test", "snapshot", "failed to initialize containers");
+        }
+        for(u32 i = 0; i < items; i++) {
+            wrm_Pool_getSlot(&sp);
+            ((Linked*)wrm_Pool_at(&sp, i))->value = i * 7;
+            if(i) { wrm_Tree_addChild(&st, (i - 1) / 4, i); }
+            *(u32*)wrm_Stack_at(&ss, wrm_Stack_push(&ss).val) = i;
+        }
+        for(u32 i = 0; i < items; i += 10) {
+            wrm_Tree_detach(&st, i + 9);
+            wrm_Pool_freeSlot(&sp, i + 9);
+        }
+        if(!wrm_Tree_flatten(&st)) wrm_fail(1, "Test", "snapshot", "failed to flatten");
+        wrm_Option_Ref kept = wrm_Pool_getRef(&sp, 5);
+
+        wrm_Pool_Snapshot ps = { 0 };
+        wrm_Tree_Snapshot ts = { 0 };
+        wrm_Stack_Snapshot ks = { 0 };
+        if(!wrm_Pool_snapshot(&sp, &ps, true) || !wrm_Tree_snapshot(&st, &ts) || !wrm_Stack_snapshot(&ss, &ks)) {
+            wrm_fail(1, "Test", "snapshot", "failed to take snapshots");
+        }
+
+        // what the restores must bring back
+        size_t used = sp.used_cnt, top = sp.top, flat_len = st.flat_len;
+        Linked *data = malloc(used * sizeof(Linked));
+        u32 *gens = malloc(sp.cap * sizeof(u32));
+        u32 *order = malloc(flat_len * sizeof(u32));
+        memcpy(data, sp.data, used * sizeof(Linked));
+        memcpy(gens, sp.gens, sp.cap * sizeof(u32));
+        memcpy(order, st.order, flat_len * sizeof(u32));
+
+        for(u32 round = 0; round < 2; round++) {
+            ((Linked*)wrm_Pool_at(&sp, 3))->value = 1000;
+            wrm_Tree_detach(&st, 5);
+            wrm_Pool_freeSlot(&sp, 5);
+            wrm_Option_Ref added = OPTION_NONE(Ref);
+            for(u32 i = 0; i < 200; i++) {
+                wrm_Option_Handle h = wrm_Pool_getSlot(&sp);
+                if(i == 0) { added = wrm_Pool_getRef(&sp, h.val); }
+                wrm_Tree_addChild(&st, 3, h.val);
+            }
+            wrm_Tree_flatten(&st);
+            *(u32*)wrm_Stack_at(&ss, 0) = 1000;
+            wrm_Stack_reset(&ss, 10);
+
+            // the second round restores everything to check the full path too
+            bool delta = round == 0;
+            u32 dirty = 0;
+            for(u32 i = wrm_bitNext(sp.dirty, 0, used); i < used; i = wrm_bitNext(sp.dirty, i + 1, used)) { dirty++; }
+            if(delta && (dirty == 0 || dirty > 16)) wrm_fail(1, "Test", "snapshot", "%u elements marked as written", dirty);
+
+            if(!wrm_Pool_restore(&sp, &ps, delta) || !wrm_Tree_restore(&st, &ts) || !wrm_Stack_restore(&ss, &ks)) {
+                wrm_fail(1, "Test", "snapshot", "failed to restore (round %u)", round);
+            }
+            if(sp.used_cnt != used || sp.top != top || memcmp(sp.data, data, used * sizeof(Linked))) {
+                wrm_fail(1, "Test", "snapshot", "pool differs after restore (round %u)", round);
+            }
+            for(u32 i = 0; i < ps.cap; i++) {
+                bool live = wrm_bitAt(ps.in_use, i);
+                if(live ? sp.gens[i] != gens[i] : (sp.gens[i] & 1) || sp.gens[i] < gens[i]) {
+                    wrm_fail(1, "Test", "snapshot", "generation of slot %u differs after restore (round %u)", i, round);
+                }
+            }
+            if(st.stale || st.flat_len != flat_len || memcmp(st.order, order, flat_len * sizeof(u32))) {
+                wrm_fail(1, "Test", "snapshot", "tree differs after restore (round %u)", round);
+            }
+            if(ss.len != items || *(u32*)wrm_Stack_at(&ss, 0) != 0 || *(u32*)wrm_Stack_at(&ss, items - 1) != items - 1) {
+                wrm_fail(1, "Test", "snapshot", "stack differs after restore (round %u)", round);
+            }
+            if(!wrm_Pool_deref(&sp, kept.val) || wrm_Pool_deref(&sp, added.val)) {
+                wrm_fail(1, "Test", "snapshot", "references do not match the snapshot (round %u)", round);
+            }
+            for(u32 i = sp.top; i < sp.cap; i++) {
+                if(wrm_Pool_isValid(&sp, i) || (sp.gens[i] & 1)) wrm_fail(1, "Test", "snapshot", "slot %u grown into is still live", i);
+            }
+        }
+
+        free(data);
+        free(gens);
+        free(order);
+        wrm_Pool_Snapshot_delete(&ps);
+        wrm_Tree_Snapshot_delete(&ts);
+        wrm_Stack_Snapshot_delete(&ks);
+        wrm_Tree_delete(&st);
+        wrm_Pool_delete(&sp, NULL);
+        wrm_Stack_delete(&ss, NULL);
+
+        // a reference to a slot taken after the snapshot stays stale once the slot is handed out again
+        wrm_Pool rp;
+        wrm_Pool_Snapshot rs = { 0 };
+        if(!wrm_Pool_init(&rp, 4, sizeof(Test), true, NULL)) wrm_fail(1, "Test", "snapshot", "failed to initialize pool");
+        wrm_Pool_getSlot(&rp);
+        if(!wrm_Pool_snapshot(&rp, &rs, true)) wrm_fail(1, "Test", "snapshot", "failed to take snapshot");
+        wrm_Option_Ref later = wrm_Pool_getRef(&rp, wrm_Pool_getSlot(&rp).val);
+        if(!later.exists || !wrm_Pool_restore(&rp, &rs, true)) wrm_fail(1, "Test", "snapshot", "failed to restore");
+        wrm_Option_Handle again = wrm_Pool_getSlot(&rp);
+        if(!again.exists || again.val != later.val.idx) wrm_fail(1, "Test", "snapshot", "expected the slot to be handed out again");
+        if(wrm_deref(later.val)) wrm_fail(1, "Test", "snapshot", "reference taken after the snapshot resolves to a new item");
+        wrm_Pool_Snapshot_delete(&rs);
+        wrm_Pool_delete(&rp, NULL);
+    }
+
+    // test the radix sort: order, stability, and keys that only differ in a few bytes
+    {
+        const u32 n = 5000;
+        wrm_Sort_Key *keys = malloc(n * sizeof(wrm_Sort_Key));
+        wrm_Sort_Key *tmp = malloc(n * sizeof(wrm_Sort_Key));
+        srand(3);
+        for(u32 i = 0; i < n; i++) {
+            u64 key = (u64)(rand() % 50) << 56 | (u64)(rand() % 4) << 20 | (u64)(rand() % 3);
+            keys[i] = (wrm_Sort_Key){ .key = key, .idx = i };
+        }
+        wrm_radixSort(keys, tmp, n);
+        for(u32 i = 1; i < n; i++) {
+            if(keys[i - 1].key > keys[i].key) wrm_fail(1, "Test", "radix sort", "keys out of order at %u", i);
+            if(keys[i - 1].key == keys[i].key && keys[i - 1].idx > keys[i].idx) wrm_fail(1, "Test", "radix sort", "equal keys swapped at %u", i);
+        }
+        free(keys);
+        free(tmp);
+    }
 
     printf("SUCCESS\n");
 }
@@ -22,11 +22,11 @@ int main(int argc, char **argv)
         .name = "Test wrm-render"
     };
 
-    if(!wrm_render_init(&settings, &window_data)) {
+    if(!wrm_render_init(&settings, &window_data, NULL)) {
         wrm_fail(1, "Test", "main()", "failed to initialize renderer");
     }
 
-    if(!wrm_gui_init("src/shaders")) {
+    if(!wrm_gui_init("src/shaders", NULL)) {
         wrm_fail(1, "Test", "main()", "failed to initialize the menu system");
     }
 
@@ -19,7 +19,7 @@ void test_init(void)
         .name = "Test wrm-render"
     };
 
-    if(!wrm_render_init(&settings, &window_data)) {
+    if(!wrm_render_init(&settings, &window_data, NULL)) {
         wrm_fail(1, "Test", "main()", "Failed to start renderer!");
     }
 }